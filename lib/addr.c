@@ -11,8 +11,27 @@
 #include "rmd160.c"
 #include "rmd160s.c"
 #include "sha256.c"
-
-#define HASH_BATCH_SIZE ((size_t)RMD_LEN)
+#include "sha256s.c"
+
+// multi-buffer sha256 is used without SHA extensions, and with AVX-512, where 16 lanes
+// outrun single-stream SHA-NI; build with -DNO_SHA_SIMD to disable it
+#if defined(SHA_LEN) && (!defined(__SHA__) || SHA_LEN >= 16) && !defined(NO_SHA_SIMD)
+  #define HASH_SHA_SIMD 1
+#endif
+
+// with SHA extensions the scalar path hashes lanes in interleaved groups of SHA_NI_WAYS
+// (1, 2 or 4); see sha256_final_x* lines in `ecloop bench` to pick the best for a CPU
+#if !defined(__x86_64__) || !defined(__SHA__)
+  #undef SHA_NI_WAYS
+#elif !defined(SHA_NI_WAYS)
+  #define SHA_NI_WAYS 2
+#endif
+
+#if defined(HASH_SHA_SIMD) && SHA_LEN > RMD_LEN
+  #define HASH_BATCH_SIZE ((size_t)SHA_LEN)
+#else
+  #define HASH_BATCH_SIZE ((size_t)RMD_LEN)
+#endif
 typedef u32 h160_t[5];
 
 int compare_160(const void *a, const void *b) {
@@ -30,12 +49,10 @@ void print_h160(const h160_t h) {
   printf("\n");
 }
 
-void prepare33(u8 msg[64], const pe *point) {
-  assert(*point->z == 1); // point should be in affine coordinates
-
-  msg[0] = point->y[0] & 1 ? 0x03 : 0x02;
+void prepare33(u8 msg[64], const fe x, const fe y) {
+  msg[0] = y[0] & 1 ? 0x03 : 0x02;
   for (int i = 0; i < 4; i++) {
-    u64 x_be = swap64(point->x[3 - i]);
+    u64 x_be = swap64(x[3 - i]);
     memcpy(&msg[1 + i * 8], &x_be, sizeof(u64));
   }
 
@@ -44,20 +61,18 @@ void prepare33(u8 msg[64], const pe *point) {
   msg[63] = 0x08;
 }
 
-void prepare65(u8 msg[128], const pe *point) {
-  assert(*point->z == 1); // point should be in affine coordinates
-
+void prepare65(u8 msg[128], const fe x, const fe y) {
   msg[0] = 0x04;
 
-  // copy point->x into msg[1..33] in big-endian order
+  // copy x into msg[1..33] in big-endian order
   for (int i = 0; i < 4; i++) {
-    u64 x_be = swap64(point->x[3 - i]);
+    u64 x_be = swap64(x[3 - i]);
     memcpy(&msg[1 + i * 8], &x_be, sizeof(u64));
   }
 
-  // copy point->y into msg[33..65] in big-endian order
+  // copy y into msg[33..65] in big-endian order
   for (int i = 0; i < 4; i++) {
-    u64 y_be = swap64(point->y[3 - i]);
+    u64 y_be = swap64(y[3 - i]);
     memcpy(&msg[33 + i * 8], &y_be, sizeof(u64));
   }
 
@@ -76,7 +91,8 @@ void addr33(u32 r[5], const pe *point) {
   u8 msg[64] = {0}; // sha256 payload
   u32 rs[16] = {0}; // sha256 output and rmd160 input
 
-  prepare33(msg, point);
+  assert(*point->z == 1); // point should be in affine coordinates
+  prepare33(msg, point->x, point->y);
   sha256_final(rs, msg, sizeof(msg));
 
   prepare_rmd(rs);
@@ -87,7 +103,8 @@ void addr65(u32 *r, const pe *point) {
   u8 msg[128] = {0}; // sha256 payload
   u32 rs[16] = {0};  // sha256 output and rmd160 input
 
-  prepare65(msg, point);
+  assert(*point->z == 1); // point should be in affine coordinates
+  prepare65(msg, point->x, point->y);
   sha256_final(rs, msg, sizeof(msg));
 
   prepare_rmd(rs);
@@ -96,36 +113,87 @@ void addr65(u32 *r, const pe *point) {
 
 // MARK: SIMD
 
-void addr33_batch(h160_t *hashes, const pe *points, size_t count) {
-  assert(count <= HASH_BATCH_SIZE);
-  u8 msg[HASH_BATCH_SIZE][64] = {0}; // sha256 payload
-  u32 rs[HASH_BATCH_SIZE][16] = {0}; // sha256 output and rmd160 input
-
-  for (size_t i = 0; i < count; ++i) prepare33(msg[i], points + i);
-  for (size_t i = 0; i < count; ++i) sha256_final(rs[i], msg[i], sizeof(msg[i]));
+#ifdef HASH_SHA_SIMD
+  #if SHA_LEN == RMD_LEN
+    #define SHA_PART(x, k) (x)
+  #elif SHA_LEN == 16 && RMD_LEN == 8
+    #define SHA_PART(x, k) ((k) ? _mm512_extracti64x4_epi64(x, 1) : _mm512_castsi512_si256(x))
+  #endif
+
+// sha256 digests (in registers) -> rmd160 message, padding for 32 bytes set in place
+void _rmd160_from_sha(h160_t *hashes, const SHA_VEC st[8]) {
+  RMD_VEC w[16];
+  for (int i = 8; i < 16; ++i) w[i] = RMD_LD_NUM(0);
+  w[8] = RMD_LD_NUM(0x00000080);
+  w[14] = RMD_LD_NUM(256);
+
+  for (int k = 0; k < SHA_LEN / RMD_LEN; ++k) {
+    for (int i = 0; i < 8; ++i) w[i] = RMD_SWAP(SHA_PART(st[i], k));
+    rmd160_batch_w(hashes + k * RMD_LEN, w);
+  }
+}
+#endif
+
+// sha256 of `count` messages of `size` bytes each (laid out as `u8 msg[count][size]`)
+void _sha256_lanes(u32 rs[][8], const u8 *msg, u32 size, size_t count) {
+  size_t i = 0;
+
+#if defined(SHA_NI_WAYS) && SHA_NI_WAYS == 4
+  for (; i + 4 <= count; i += 4) {
+    u32 *st[4] = {rs[i], rs[i + 1], rs[i + 2], rs[i + 3]};
+    const u8 *dt[4] = {msg + i * size, msg + (i + 1) * size, msg + (i + 2) * size,
+                       msg + (i + 3) * size};
+    sha256_final_x4(st, dt, size);
+  }
+#endif
 
-  // for (size_t i = 0; i < count; ++i) prepare_rmd(rs[i]);
-  for (size_t i = 0; i < count; ++i) {
-    rs[i][8] = 0x80000000;  // 80 in little-endian
-    rs[i][14] = 0x00010000; // 256 in little-endian
+#if defined(SHA_NI_WAYS) && SHA_NI_WAYS >= 2
+  for (; i + 2 <= count; i += 2) {
+    u32 *st[2] = {rs[i], rs[i + 1]};
+    const u8 *dt[2] = {msg + i * size, msg + (i + 1) * size};
+    sha256_final_x2(st, dt, size);
   }
+#endif
 
-  rmd160_batch(hashes, rs);
+  for (; i < count; ++i) sha256_final(rs[i], msg + i * size, size);
 }
 
-void addr65_batch(h160_t *hashes, const pe *points, size_t count) {
-  assert(count <= HASH_BATCH_SIZE);
-  u8 msg[HASH_BATCH_SIZE][128] = {0}; // sha256 payload
-  u32 rs[HASH_BATCH_SIZE][16] = {0};  // sha256 output and rmd160 input
+// sha256 digests (native words, row per lane) -> rmd160 message transposed in registers
+void _rmd160_from_rows(h160_t *hashes, const u32 rs[HASH_BATCH_SIZE][8]) {
+  RMD_VEC w[16];
+  for (int i = 8; i < 16; ++i) w[i] = RMD_LD_NUM(0);
+  w[8] = RMD_LD_NUM(0x00000080);
+  w[14] = RMD_LD_NUM(256);
+
+  for (size_t k = 0; k < HASH_BATCH_SIZE; k += RMD_LEN) {
+    RMD_LOAD_ROWS(w, (rs + k));
+    for (int i = 0; i < 8; ++i) w[i] = RMD_SWAP(w[i]);
+    rmd160_batch_w(hashes + k, w);
+  }
+}
 
-  for (size_t i = 0; i < count; ++i) prepare65(msg[i], points + i);
-  for (size_t i = 0; i < count; ++i) sha256_final(rs[i], msg[i], sizeof(msg[i]));
+// hash160 of `count` points (compressed or not). SHA-256 digests go to RIPEMD-160 as
+// transposed vectors, without per-lane padding and scalar gathers in between.
+void hash160_batch(h160_t *hashes, const pe_batch_t points, size_t count, bool compressed) {
+  assert(count <= HASH_BATCH_SIZE);
+  const u32 size = compressed ? 64 : 128;
+  u8 msg[HASH_BATCH_SIZE * 128]; // sha256 payload, `size` bytes per lane
+  memset(msg, 0, HASH_BATCH_SIZE * size);
 
-  // for (size_t i = 0; i < count; ++i) prepare_rmd(rs[i]);
   for (size_t i = 0; i < count; ++i) {
-    rs[i][8] = 0x80000000;  // 80 in little-endian
-    rs[i][14] = 0x00010000; // 256 in little-endian
+    if (compressed) prepare33(msg + i * size, points.x[i], points.y[i]);
+    else prepare65(msg + i * size, points.x[i], points.y[i]);
   }
 
-  rmd160_batch(hashes, rs);
+#ifdef HASH_SHA_SIMD
+  SHA_VEC st[8]; // sha256 output (kept in registers as rmd160 input)
+  if (compressed) sha256_batch(st, msg, size);
+  else sha256_batch65(st, msg);
+  _rmd160_from_sha(hashes, st);
+#else
+  u32 rs[HASH_BATCH_SIZE][8]; // sha256 output, lanes past `count` are not used
+  _sha256_lanes(rs, msg, size, count);
+  for (size_t i = count; i < HASH_BATCH_SIZE; ++i) memset(rs[i], 0, sizeof(rs[i]));
+  _rmd160_from_rows(hashes, rs);
+#endif
 }
@@ -7,11 +7,13 @@
 
 #include "addr.c"
 #include "ecc.c"
+#include "ecc_ifma.c"
 #include "utils.c"
 
-void print_res(char *label, size_t stime, size_t iters) {
+double print_res(char *label, size_t stime, size_t iters) {
   double dt = MAX((tsnow() - stime), 1ul) / 1000.0;
   printf("%20s: %.2fM it/s ~ %.2fs\n", label, iters / dt / 1000000, dt);
+  return iters / dt;
 }
 
 void run_bench() {
@@ -31,6 +33,36 @@ void run_bench() {
   print_res("_ec_jacobi_add1", stime, iters);
   assert(fe_cmp(g.x, G1.x) != 0);
 
+#if HAS_X86_ASM
+  // field mul / sqr backends: portable C vs MULX / ADCX / ADOX
+  if (cpu_has_adx()) {
+    bool use_adx = _fe_use_adx;
+    double rc, ra;
+
+    _fe_use_adx = false;
+    pe_clone(&g, &G2);
+    stime = tsnow();
+    for (i = 0; i < iters; ++i) _ec_jacobi_add1(&g, &g, &G1);
+    rc = print_res("_ec_jacobi_add1 (c)", stime, iters);
+
+    _fe_use_adx = true;
+    pe_clone(&g, &G2);
+    stime = tsnow();
+    for (i = 0; i < iters; ++i) _ec_jacobi_add1(&g, &g, &G1);
+    ra = print_res("_ec_jacobi_add1 (adx)", stime, iters);
+    printf("%20s: x%.2f\n", "adx speedup", ra / rc);
+    assert(fe_cmp(g.x, G1.x) != 0);
+
+    _fe_use_adx = use_adx;
+  }
+#endif
+
+  pe_clone(&g, &G2);
+  stime = tsnow();
+  for (i = 0; i < iters; ++i) _ec_jacobi_add52(&g, &g, &G1);
+  print_res("_ec_jacobi_add52", stime, iters);
+  assert(fe_cmp(g.x, G1.x) != 0);
+
   pe_clone(&g, &G2);
   stime = tsnow();
   for (i = 0; i < iters; ++i) _ec_jacobi_add2(&g, &g, &G1);
@@ -83,6 +115,25 @@ void run_bench() {
   print_res("ec_affine_dbl", stime, iters);
   assert(fe_cmp(g.x, G1.x) != 0);
 
+  // affine addition with known inverse (batch_add inner loop): scalar vs 8-lane IFMA
+  iters = 1000 * 1000 * 4;
+  pe bp[8];
+  fe rx, ry, inv[8], bx[8], by[8];
+  for (i = 0; i < 8; ++i) pe_clone(&bp[i], &G2), fe_clone(inv[i], g.x);
+  fe_clone(rx, g.x);
+
+  stime = tsnow();
+  for (i = 0; i < iters; ++i) ec_affine_add_inv(rx, ry, G1.x, G1.y, g.x, g.y, rx);
+  print_res("ec_affine_add_inv", stime, iters);
+  assert(fe_cmp(rx, G1.x) != 0);
+
+  if (_ec_use_ifma) {
+    stime = tsnow();
+    for (i = 0; i < iters; i += 8) ec_affine_add_inv_x8(bx, by, 1, &G1, bp, inv);
+    print_res("ec_affine_add_inv_x8", stime, iters);
+    assert(fe_cmp(bx[0], G1.x) != 0);
+  }
+
   // modular inversion
   iters = 1000 * 100;
 
@@ -96,6 +147,11 @@ void run_bench() {
   print_res("_fe_modinv_addchn", stime, iters);
   assert(fe_cmp(f, G1.x) != 0);
 
+  stime = tsnow();
+  for (i = 0; i < iters; ++i) _fe_modp_inv_safegcd(f, g.x);
+  print_res("_fe_modinv_safegcd", stime, iters);
+  assert(fe_cmp(f, G1.x) != 0);
+
   // hash functions
   iters = 1000 * 1000 * 10;
   h160_t h160;
@@ -109,6 +165,55 @@ void run_bench() {
   for (i = 0; i < iters; ++i) addr65(h160, &g);
   print_res("addr65", stime, iters);
   assert(h160[0] != 0);
+
+#if defined(__x86_64__) && defined(__SHA__)
+  // sha-ni with 1, 2 and 4 interleaved streams (addr33 message size)
+  u8 sm[4][64] = {0};
+  u32 ss[4][8] = {0};
+  u32 *sp[4] = {ss[0], ss[1], ss[2], ss[3]};
+  const u8 *mp[4] = {sm[0], sm[1], sm[2], sm[3]};
+
+  stime = tsnow();
+  for (i = 0; i < iters; ++i) sha256_final(ss[0], sm[0], 64), sm[0][1] = ss[0][0];
+  print_res("sha256_final", stime, iters);
+
+  stime = tsnow();
+  for (i = 0; i < iters; i += 2) {
+    sha256_final_x2(sp, mp, 64);
+    for (int j = 0; j < 2; ++j) sm[j][1] = ss[j][0]; // keep every stream live
+  }
+  print_res("sha256_final_x2", stime, iters);
+
+  stime = tsnow();
+  for (i = 0; i < iters; i += 4) {
+    sha256_final_x4(sp, mp, 64);
+    for (int j = 0; j < 4; ++j) sm[j][1] = ss[j][0];
+  }
+  print_res("sha256_final_x4", stime, iters);
+  assert(ss[0][0] != 0 && ss[3][0] != 0);
+#endif
+
+  // batch hashing (multi-buffer sha256 when HASH_SHA_SIMD is set)
+  h160_t hs[HASH_BATCH_SIZE];
+  fe hx[HASH_BATCH_SIZE], hy[HASH_BATCH_SIZE];
+  pe_batch_t hp = {.x = hx, .y = hy};
+  for (i = 0; i < HASH_BATCH_SIZE; ++i) fe_clone(hx[i], g.x), fe_clone(hy[i], g.y);
+
+  stime = tsnow();
+  for (i = 0; i < iters; i += HASH_BATCH_SIZE) hash160_batch(hs, hp, HASH_BATCH_SIZE, true);
+  print_res("hash160_batch33", stime, iters);
+  assert(hs[0][0] != 0);
+
+  stime = tsnow();
+  for (i = 0; i < iters; i += HASH_BATCH_SIZE) hash160_batch(hs, hp, HASH_BATCH_SIZE, false);
+  print_res("hash160_batch65", stime, iters);
+  assert(hs[0][0] != 0);
+
+  // ripemd160 alone (RMD_LEN lanes per call)
+  u32 rm[RMD_LEN][16] = {0};
+  stime = tsnow();
+  for (i = 0; i < iters; i += RMD_LEN) rmd160_batch(hs, rm), rm[0][0] = hs[0][0];
+  print_res("rmd160_batch", stime, iters);
 }
 
 void run_bench_gtable() {
@@ -135,8 +240,8 @@ void run_bench_gtable() {
     mult = ((double)(tsnow() - stime)) / 1000;
 
     double mem = (double)mem_used / 1024 / 1024;                              // MB
-    printf("w=%02d: %.1fK it/s | gen: %5.2fs | mul: %5.2fs | mem: %8.1fMB\n", //
-           i, iters / mult / 1000, gent, mult, mem);
+    printf("w=%02d: %.1fK it/s | gen: %5.2fs | mul: %5.2fs | mem: %8.1fMB (%s)\n", //
+           i, iters / mult / 1000, gent, mult, mem, hp_kind_str(_gtable_mem));
   }
 }
 
@@ -0,0 +1,358 @@
+// Copyright (c) vladkens
+// https://github.com/vladkens/ecloop
+// Licensed under the MIT License.
+
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "addr.c"
+#include "utils.c"
+
+// Binary fuse filter (3-wise, 32-bit fingerprints) for static target sets.
+// p = 2^-32 at ~36 bits per key, and 3 memory accesses per query (any result).
+// https://arxiv.org/abs/2201.01174
+// https://github.com/FastFilter/xor_singleheader/blob/master/include/binaryfusefilter.h
+
+#define BFF_MAGIC 0x45434646 // FourCC: ECFF
+#define BFF_VERSION 1
+#define BFF_MAX_ITERATIONS 100
+
+typedef struct bff_t {
+  u64 seed;
+  u32 seg_len;       // segment length (power of 2)
+  u32 seg_count_len; // segment count * segment length
+  u32 size;          // number of fingerprints
+  u32 *fp;
+} bff_t;
+
+INLINE u64 bff_mix(u64 h) {
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdull;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ull;
+  h ^= h >> 33;
+  return h;
+}
+
+INLINE u64 bff_key(const h160_t h) { return (u64)h[0] << 32 | h[1]; }
+
+INLINE u32 bff_fingerprint(u64 hash) { return (u32)(hash ^ hash >> 32); }
+
+// position of key in segment i (0..2), segments i and i + 1 follow segment 0
+INLINE u32 bff_pos(const bff_t *f, u64 hash, u32 i) {
+  u64 h = (u64)(((u128)hash * f->seg_count_len) >> 64) + i * f->seg_len;
+  u64 hh = hash & ((1ull << 36) - 1);
+  return (u32)(h ^ ((hh >> (36 - 18 * i)) & (f->seg_len - 1)));
+}
+
+bool bff_has(const bff_t *f, const h160_t h) {
+  u64 hash = bff_mix(bff_key(h) + f->seed);
+  u32 x = bff_fingerprint(hash);
+  x ^= f->fp[bff_pos(f, hash, 0)] ^ f->fp[bff_pos(f, hash, 1)] ^ f->fp[bff_pos(f, hash, 2)];
+  return x == 0;
+}
+
+INLINE void bff_prefetch(const bff_t *f, const h160_t h) {
+  u64 hash = bff_mix(bff_key(h) + f->seed);
+  for (u32 i = 0; i < 3; ++i) __builtin_prefetch(&f->fp[bff_pos(f, hash, i)]);
+}
+
+// same interface as blf_has8; positions for all 8 hashes are computed before any load,
+// so the 24 loads are independent and can overlap
+void bff_has8(uint8_t out[8], const bff_t *f, const h160_t *hashes) {
+  u32 p0[8], p1[8], p2[8], fp[8];
+  for (int i = 0; i < 8; ++i) {
+    u64 hash = bff_mix(bff_key(hashes[i]) + f->seed);
+    fp[i] = bff_fingerprint(hash);
+    p0[i] = bff_pos(f, hash, 0);
+    p1[i] = bff_pos(f, hash, 1);
+    p2[i] = bff_pos(f, hash, 2);
+  }
+
+  for (int i = 0; i < 8; ++i) out[i] = (fp[i] ^ f->fp[p0[i]] ^ f->fp[p1[i]] ^ f->fp[p2[i]]) == 0;
+}
+
+// MARK: construction
+
+INLINE u64 bff_splitmix64(u64 *state) {
+  u64 z = (*state += 0x9E3779B97F4A7C15ull);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+  return z ^ (z >> 31);
+}
+
+int bff_cmp_u64(const void *a, const void *b) {
+  u64 x = *(const u64 *)a, y = *(const u64 *)b;
+  return x < y ? -1 : x > y;
+}
+
+// log2(n) in 16.16 fixed point: integer part from clz, fraction bits by squaring mantissa
+INLINE u32 bff_log2_fx(u32 n) {
+  u32 ip = 31 - __builtin_clz(n);
+  u64 x = ((u64)n << 32) >> ip; // mantissa in [1, 2) as 1.32
+  u32 r = ip << 16;
+  for (u32 b = 1u << 15; b != 0; b >>= 1) {
+    x = (u64)(((u128)x * x) >> 32);
+    if (x >> 33) x >>= 1, r |= b;
+  }
+  return r;
+}
+
+// sizes from reference: seg_len = 2^floor(ln(n) / ln(3.33) + 2.25),
+// capacity = n * max(1.125, 0.875 + 0.25 * ln(1e6) / ln(n)); in fixed point, without libm
+void bff_init(bff_t *f, u32 count) {
+  u32 lg = count > 1 ? bff_log2_fx(count) : 0;
+  u32 seg_len = count > 1 ? 1u << (((u64)lg * 37762 + (9ull << 30)) >> 32) : 4; // 1/log2(3.33)
+  seg_len = MIN(seg_len, 262144u);
+
+  u64 factor = count > 1 ? MAX(73728ull, 57344 + 21401358791ull / lg) : 0; // 16.16
+  u32 capacity = (u32)(((u64)count * factor + 32768) >> 16);
+  u32 seg_count = (capacity + seg_len - 1) / seg_len;
+  seg_count = seg_count <= 2 ? 1 : seg_count - 2;
+
+  f->seed = 0;
+  f->seg_len = seg_len;
+  f->seg_count_len = seg_count * seg_len;
+  f->size = (seg_count + 2) * seg_len;
+  f->fp = calloc(f->size, sizeof(u32));
+  if (f->fp == NULL) {
+    fprintf(stderr, "failed to allocate binary fuse filter (%'zu bytes)\n", f->size * sizeof(u32));
+    exit(1);
+  }
+}
+
+// build filter from unique keys (see bff_key); returns false if no seed works
+bool bff_build(bff_t *f, const u64 *keys, u32 count) {
+  bff_init(f, count);
+
+  u32 capacity = f->size;
+  u64 *order = calloc(count + 1, sizeof(u64)); // hashes sorted by segment, then peel order
+  u8 *order_pos = malloc(MAX(count, 1u));      // which of 3 positions was alone when peeled
+  u32 *alone = malloc(capacity * sizeof(u32));
+  u8 *t2count = calloc(capacity, 1);           // (keys at slot << 2) | xor of position indices
+  u64 *t2hash = calloc(capacity, sizeof(u64)); // xor of hashes at slot
+
+  u32 block_bits = 1;
+  while ((1u << block_bits) < f->seg_count_len / f->seg_len) block_bits += 1;
+  u32 block = 1u << block_bits;
+  u32 *start = malloc(block * sizeof(u32));
+  bool is_alloc = order != NULL && order_pos != NULL && alone != NULL && start != NULL;
+  if (!is_alloc || t2count == NULL || t2hash == NULL) {
+    fprintf(stderr, "failed to allocate binary fuse filter construction buffers\n");
+    exit(1);
+  }
+
+  u64 rng = 0x726b2b9d438b9d4dull;
+  bool is_ok = false;
+
+  for (int loop = 0; loop < BFF_MAX_ITERATIONS && !is_ok; ++loop) {
+    f->seed = bff_splitmix64(&rng);
+    memset(order, 0, (count + 1) * sizeof(u64));
+    memset(t2count, 0, capacity);
+    memset(t2hash, 0, capacity * sizeof(u64));
+    order[count] = 1; // sentinel
+
+    // bucket hashes by their segment, so slot updates below walk memory in order
+    for (u32 i = 0; i < block; ++i) start[i] = (u32)(((u64)i * count) >> block_bits);
+    for (u32 i = 0; i < count; ++i) {
+      u64 hash = bff_mix(keys[i] + f->seed);
+      u64 seg = hash >> (64 - block_bits);
+      while (order[start[seg]] != 0) seg = (seg + 1) & (block - 1);
+      order[start[seg]++] = hash;
+    }
+
+    bool error = false;
+    for (u32 i = 0; i < count; ++i) {
+      u64 hash = order[i];
+      for (u32 k = 0; k < 3; ++k) {
+        u32 p = bff_pos(f, hash, k);
+        t2count[p] += 4;
+        t2count[p] ^= k;
+        t2hash[p] ^= hash;
+        error = error || t2count[p] < 4; // u8 counter overflow
+      }
+    }
+    if (error) continue;
+
+    // peel slots with a single key
+    u32 qsize = 0, stack = 0;
+    for (u32 i = 0; i < capacity; ++i) {
+      alone[qsize] = i;
+      qsize += (t2count[i] >> 2) == 1 ? 1 : 0;
+    }
+
+    while (qsize > 0) {
+      u32 idx = alone[--qsize];
+      if ((t2count[idx] >> 2) != 1) continue;
+
+      u64 hash = t2hash[idx];
+      u8 found = t2count[idx] & 3;
+      order_pos[stack] = found;
+      order[stack] = hash;
+      stack += 1;
+
+      for (u32 k = 1; k <= 2; ++k) {
+        u32 other = (found + k) % 3;
+        u32 p = bff_pos(f, hash, other);
+        alone[qsize] = p;
+        qsize += (t2count[p] >> 2) == 2 ? 1 : 0;
+        t2count[p] -= 4;
+        t2count[p] ^= other;
+        t2hash[p] ^= hash;
+      }
+    }
+
+    is_ok = stack == count;
+  }
+
+  // assign fingerprints in reverse peel order
+  for (u32 i = count; is_ok && i-- > 0;) {
+    u64 hash = order[i];
+    u32 p[3] = {bff_pos(f, hash, 0), bff_pos(f, hash, 1), bff_pos(f, hash, 2)};
+    u8 found = order_pos[i];
+    f->fp[p[found]] = bff_fingerprint(hash) ^ f->fp[p[(found + 1) % 3]] ^ f->fp[p[(found + 2) % 3]];
+  }
+
+  free(order);
+  free(order_pos);
+  free(alone);
+  free(t2count);
+  free(t2hash);
+  free(start);
+  return is_ok;
+}
+
+bool bff_save(const char *filepath, const bff_t *f) {
+  FILE *file = file_create(filepath, "wb"); // see file_replace
+  if (file == NULL) {
+    fprintf(stderr, "failed to open output file\n");
+    exit(1);
+  }
+
+  u32 head[2] = {BFF_MAGIC, BFF_VERSION};
+  u32 dims[4] = {f->seg_len, f->seg_count_len, f->size, 0};
+
+  bool is_ok = true;
+  is_ok = is_ok && fwrite(head, sizeof(head), 1, file) == 1;
+  is_ok = is_ok && fwrite(&f->seed, sizeof(f->seed), 1, file) == 1;
+  is_ok = is_ok && fwrite(dims, sizeof(dims), 1, file) == 1;
+  is_ok = is_ok && fwrite(f->fp, sizeof(u32), f->size, file) == f->size;
+  is_ok = file_replace(file, filepath, is_ok);
+  if (!is_ok) fprintf(stderr, "failed to write binary fuse filter\n");
+  return is_ok;
+}
+
+bool bff_load(const char *filepath, bff_t *f) {
+  FILE *file = fopen(filepath, "rb");
+  if (file == NULL) {
+    fprintf(stderr, "failed to open input file\n");
+    return false;
+  }
+
+  u32 head[2], dims[4];
+  bool is_ok = true;
+  is_ok = is_ok && fread(head, sizeof(head), 1, file) == 1;
+  is_ok = is_ok && fread(&f->seed, sizeof(f->seed), 1, file) == 1;
+  is_ok = is_ok && fread(dims, sizeof(dims), 1, file) == 1;
+  if (!is_ok || head[0] != BFF_MAGIC || head[1] != BFF_VERSION) {
+    fprintf(stderr, "invalid binary fuse filter; create a new filter with bff-gen command\n");
+    fclose(file);
+    return false;
+  }
+
+  f->seg_len = dims[0];
+  f->seg_count_len = dims[1];
+  f->size = dims[2];
+  // bff_pos masks with seg_len - 1 inside seg_len-aligned blocks, so positions stay in
+  // bounds only for power of 2 seg_len and whole number of segments
+  bool is_pow2 = f->seg_len != 0 && (f->seg_len & (f->seg_len - 1)) == 0;
+  bool is_whole = is_pow2 && f->seg_count_len != 0 && f->seg_count_len % f->seg_len == 0;
+  if (!is_whole || f->size != (u64)f->seg_count_len + 2 * (u64)f->seg_len) {
+    fprintf(stderr, "invalid binary fuse filter size\n");
+    fclose(file);
+    return false;
+  }
+
+  f->fp = malloc(f->size * sizeof(u32));
+  if (f->fp == NULL) {
+    fprintf(stderr, "failed to allocate binary fuse filter (%'zu bytes)\n", f->size * sizeof(u32));
+    exit(1);
+  }
+
+  if (fread(f->fp, sizeof(u32), f->size, file) != f->size) {
+    fprintf(stderr, "failed to read binary fuse filter\n");
+    fclose(file);
+    return false;
+  }
+
+  fclose(file);
+  return true;
+}
+
+// MARK: bff-gen command
+
+void __bff_gen_usage(args_t *args) {
+  printf("Usage: %s bff-gen -o <file>\n", args->argv[0]);
+  printf("Generate a binary fuse filter from a list of hex-encoded hash160 values passed to "
+         "stdin.\n");
+  printf("\nOptions:\n");
+  printf("  -o <file>       - File to write filter (must have a .bff extension).\n");
+  printf("  -bin            - Read binary 20-byte hash160 records instead of hex lines.\n");
+  exit(1);
+}
+
+void bff_gen(args_t *args) {
+  char *filepath = arg_str(args, "-o");
+  if (filepath == NULL) {
+    fprintf(stderr, "[!] missing output file (-o <file>)\n");
+    return __bff_gen_usage(args);
+  }
+
+  size_t count;
+  h160_t *hashes = h160_read_all(stdin, args_bool(args, "-bin"), &count);
+  u64 *keys = malloc(MAX(count, 1ul) * sizeof(u64));
+  if (keys == NULL) {
+    fprintf(stderr, "failed to allocate keys list\n");
+    exit(1);
+  }
+
+  for (size_t i = 0; i < count; ++i) keys[i] = bff_key(hashes[i]);
+  free(hashes);
+
+  // filter is static, so duplicates are removed once here
+  qsort(keys, count, sizeof(u64), bff_cmp_u64);
+  size_t unique = 0;
+  for (size_t i = 0; i < count; ++i) {
+    if (unique == 0 || keys[unique - 1] != keys[i]) keys[unique++] = keys[i];
+  }
+
+  if (unique == 0 || unique > UINT32_MAX / 2) {
+    fprintf(stderr, "[!] invalid number of hashes: %'zu\n", unique);
+    exit(1);
+  }
+
+  printf("building binary fuse filter for %'zu hashes...\n", unique);
+
+  bff_t bff = {0};
+  if (!bff_build(&bff, keys, (u32)unique)) {
+    fprintf(stderr, "[!] failed to build binary fuse filter\n");
+    exit(1);
+  }
+
+  double mb = (double)bff.size * sizeof(u32) / 1024 / 1024;
+  double bits = (double)bff.size * 32 / unique;
+  printf("filter params: n = %'zu | p = 1:%'llu | %.1f bits per key (%'.1f MB)\n", unique,
+         1ull << 32, bits, mb);
+  printf("saving to %s\n", filepath);
+
+  if (!bff_save(filepath, &bff)) {
+    fprintf(stderr, "[!] failed to save binary fuse filter\n");
+    exit(1);
+  }
+
+  free(keys);
+  free(bff.fp);
+}
@@ -1,9 +1,11 @@
 #pragma once
+#include <stdbool.h>
 
 #define USE_BUILTIN 1
 #define HAS_BUILTIN(fn) (USE_BUILTIN && __has_builtin(fn))
 
 typedef __uint128_t u128;
+typedef __int128_t i128;
 typedef unsigned long long u64;
 typedef unsigned int u32;
 typedef unsigned char u8;
@@ -79,3 +81,126 @@ typedef unsigned char u8;
         ((x) << 8 & 0x000000ff00000000) | ((x) >> 8 & 0x00000000ff000000) |                        \
         ((x) >> 24 & 0x0000000000ff0000) | ((x) >> 40 & 0x000000000000ff00) | ((x) >> 56)
 #endif
+
+// MARK: CPU features
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+  #include <cpuid.h>
+  #define HAS_X86_ASM 1
+#else
+  #define HAS_X86_ASM 0
+#endif
+
+static bool cpu_has_adx() {
+#if HAS_X86_ASM
+  u32 eax, ebx, ecx, edx;
+  if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) return false;
+  return (ebx & (1 << 8)) && (ebx & (1 << 19)); // BMI2 (mulx) && ADX (adcx / adox)
+#else
+  return false;
+#endif
+}
+
+static bool cpu_has_avx512ifma() {
+#if HAS_X86_ASM
+  u32 eax, ebx, ecx, edx, xcr0, xcr0_hi;
+  if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || !(ecx & (1 << 27))) return false; // OSXSAVE
+  asm volatile("xgetbv" : "=a"(xcr0), "=d"(xcr0_hi) : "c"(0));
+  if ((xcr0 & 0xE6) != 0xE6) return false; // OS saves SSE, AVX & AVX-512 registers
+  if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) return false;
+  return (ebx & (1 << 16)) && (ebx & (1 << 21)); // AVX512F && AVX512IFMA
+#else
+  return false;
+#endif
+}
+
+// MARK: Huge pages
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef __linux__
+  #include <sys/mman.h>
+#endif
+
+// Backing of big randomly accessed tables (bloom filter bits, gtable). With 4K pages almost every
+// lookup is a TLB miss too; 2M / 1G pages map the same table with 512x / 262144x fewer entries.
+typedef enum { HP_HEAP, HP_THP, HP_2M, HP_1G } hp_kind;
+
+bool _HUGE_PAGES = false; // try huge pages in hp_alloc (-hugepages)
+
+#define HP_SIZE_2M (1ul << 21)
+#define HP_SIZE_1G (1ul << 30)
+
+static const char *hp_kind_str(hp_kind kind) {
+  static const char *names[] = {"heap", "THP", "2M pages", "1G pages"};
+  return names[kind];
+}
+
+static size_t hp_round(size_t size, size_t page) { return (size + page - 1) / page * page; }
+
+#ifdef __linux__
+static void *_hp_mmap(size_t size, int flags) {
+  int prot = PROT_READ | PROT_WRITE;
+  void *ptr = mmap(NULL, size, prot, MAP_PRIVATE | MAP_ANONYMOUS | flags, -1, 0);
+  return ptr == MAP_FAILED ? NULL : ptr;
+}
+
+static bool _hp_thp_enabled() {
+  // madvise(MADV_HUGEPAGE) succeeds even if THP is off, so check mode: "always [madvise] never"
+  FILE *file = fopen("/sys/kernel/mm/transparent_hugepage/enabled", "r");
+  if (file == NULL) return false;
+
+  char buf[64] = {0};
+  bool is_ok = fgets(buf, sizeof(buf), file) != NULL && strstr(buf, "[never]") == NULL;
+  fclose(file);
+  return is_ok;
+}
+#endif
+
+// zeroed, 64-byte aligned memory; with _HUGE_PAGES (and size >= 2M) tries hugetlb 1G & 2M pages
+// (need reserved pool: /proc/sys/vm/nr_hugepages), then THP, then falls back to plain heap
+static void *hp_alloc(size_t size, hp_kind *kind) {
+  void *ptr = NULL;
+
+#if defined(__linux__) && defined(MAP_HUGETLB) && defined(MAP_HUGE_SHIFT)
+  if (_HUGE_PAGES && size >= HP_SIZE_1G) {
+    ptr = _hp_mmap(hp_round(size, HP_SIZE_1G), MAP_HUGETLB | (30 << MAP_HUGE_SHIFT));
+    if (ptr != NULL) return *kind = HP_1G, ptr;
+  }
+
+  if (_HUGE_PAGES && size >= HP_SIZE_2M) {
+    ptr = _hp_mmap(hp_round(size, HP_SIZE_2M), MAP_HUGETLB | (21 << MAP_HUGE_SHIFT));
+    if (ptr != NULL) return *kind = HP_2M, ptr;
+  }
+#endif
+
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+  if (_HUGE_PAGES && size >= HP_SIZE_2M && _hp_thp_enabled()) {
+    size_t len = hp_round(size, HP_SIZE_2M);
+    if (posix_memalign(&ptr, HP_SIZE_2M, len) == 0) {
+      madvise(ptr, len, MADV_HUGEPAGE); // before first touch, so page faults get huge pages
+      memset(ptr, 0, size);
+      return *kind = HP_THP, ptr;
+    }
+  }
+#endif
+
+  *kind = HP_HEAP;
+#ifdef _WIN32
+  return calloc(size, 1); // 16-byte aligned only
+#else
+  if (posix_memalign(&ptr, 64, size) != 0) return NULL;
+  memset(ptr, 0, size);
+  return ptr;
+#endif
+}
+
+static void hp_free(void *ptr, size_t size, hp_kind kind) {
+  if (ptr == NULL) return;
+#ifdef __linux__
+  if (kind == HP_1G) return (void)munmap(ptr, hp_round(size, HP_SIZE_1G));
+  if (kind == HP_2M) return (void)munmap(ptr, hp_round(size, HP_SIZE_2M));
+#endif
+  free(ptr);
+}
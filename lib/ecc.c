@@ -313,7 +313,7 @@ void fe_modp_add(fe r, const fe a, const fe b) { // r = a + b (mod P)
   }
 }
 
-void fe_modp_mul(fe r, const fe a, const fe b) {
+void _fe_modp_mul_c(fe r, const fe a, const fe b) {
   u64 rr[8] = {0}, tt[5] = {0}, c = 0;
 
   // 256bit * 256bit -> 512bit
@@ -351,11 +351,12 @@ void fe_modp_mul(fe r, const fe a, const fe b) {
   r[1] = addc64(rr[1], hi, c, &c);
   r[2] = addc64(rr[2], 0, c, &c);
   r[3] = addc64(rr[3], 0, c, &c);
+  if (c) fe_add64(r, 0x1000003D1ULL); // wrapped over 2^256
 
   if (fe_cmp(r, FE_P) >= 0) fe_modp_sub(r, r, FE_P);
 }
 
-void fe_modp_sqr(fe r, const fe a) {
+void _fe_modp_sqr_c(fe r, const fe a) {
   // from: https://github.com/JeanLucPons/VanitySearch/blob/1.19/IntMod.cpp#L1034
   // ~8% faster than fe_modmul(r, a, a)
   // return fe_modmul(r, a, a);
@@ -448,10 +449,199 @@ void fe_modp_sqr(fe r, const fe a) {
   r[1] = addc64(rr[1], hi, c, &c);
   r[2] = addc64(rr[2], 0, c, &c);
   r[3] = addc64(rr[3], 0, c, &c);
+  if (c) fe_add64(r, 0x1000003D1ULL); // wrapped over 2^256
 
   if (fe_cmp(r, FE_P) >= 0) fe_modp_sub(r, r, FE_P);
 }
 
+#if HAS_X86_ASM
+// MULX + ADCX / ADOX kernels: two independent carry chains (CF and OF) let partial products of
+// a row be accumulated without serializing on a single carry flag. Requires BMI2 & ADX.
+
+// one row of schoolbook multiplication: [w0 w1 w2 w3 n] += a * b[i], n is a new top word
+#define _FE_ADX_ROW(i, w0, w1, w2, w3, n)                                                          \
+  "movq 8*" #i "(%[b]), %%rdx\n\t"                                                                 \
+  "xorl %k[z], %k[z]\n\t"                                                                          \
+  "mulxq 0(%[a]), %[lo], %[hi]\n\t"                                                                \
+  "adoxq %[lo], " w0 "\n\t"                                                                        \
+  "adcxq %[hi], " w1 "\n\t"                                                                        \
+  "mulxq 8(%[a]), %[lo], %[hi]\n\t"                                                                \
+  "adoxq %[lo], " w1 "\n\t"                                                                        \
+  "adcxq %[hi], " w2 "\n\t"                                                                        \
+  "mulxq 16(%[a]), %[lo], %[hi]\n\t"                                                               \
+  "adoxq %[lo], " w2 "\n\t"                                                                        \
+  "adcxq %[hi], " w3 "\n\t"                                                                        \
+  "mulxq 24(%[a]), %[lo], " n "\n\t"                                                               \
+  "adoxq %[lo], " w3 "\n\t"                                                                        \
+  "adcxq %[z], " n "\n\t"                                                                          \
+  "adoxq %[z], " n "\n\t"                                                                          \
+  "movq " w0 ", 8*" #i "(%[t])\n\t"
+
+// [x0 x1 x2 x3] + x4 * 2^256 -> [x0 x1 x2 x3] mod P, rdx = 2^256 mod P; y0-y3 are scratch
+#define _FE_ADX_FOLD(x0, x1, x2, x3, x4, y0, y1, y2, y3)                                          \
+  "mulxq " x4 ", %[lo], %[hi]\n\t"                                                                 \
+  "addq %[lo], " x0 "\n\t"                                                                         \
+  "adcq %[hi], " x1 "\n\t"                                                                         \
+  "adcq $0, " x2 "\n\t"                                                                            \
+  "adcq $0, " x3 "\n\t"                                                                            \
+  "sbbq %[lo], %[lo]\n\t" /* wrapped over 2^256: add 2^256 mod P once more */                      \
+  "andq %%rdx, %[lo]\n\t"                                                                          \
+  "addq %[lo], " x0 "\n\t"                                                                         \
+  "adcq $0, " x1 "\n\t"                                                                            \
+  "adcq $0, " x2 "\n\t"                                                                            \
+  "adcq $0, " x3 "\n\t"                                                                            \
+  "movq " x0 ", " y0 "\n\t" /* x - P = x + 2^256 mod P, take it if it carries */                   \
+  "addq %%rdx, " y0 "\n\t"                                                                         \
+  "movq " x1 ", " y1 "\n\t"                                                                        \
+  "adcq $0, " y1 "\n\t"                                                                            \
+  "movq " x2 ", " y2 "\n\t"                                                                        \
+  "adcq $0, " y2 "\n\t"                                                                            \
+  "movq " x3 ", " y3 "\n\t"                                                                        \
+  "adcq $0, " y3 "\n\t"                                                                            \
+  "cmovcq " y0 ", " x0 "\n\t"                                                                      \
+  "cmovcq " y1 ", " x1 "\n\t"                                                                      \
+  "cmovcq " y2 ", " x2 "\n\t"                                                                      \
+  "cmovcq " y3 ", " x3 "\n\t"                                                                      \
+  "movq " x0 ", 0(%[r])\n\t"                                                                       \
+  "movq " x1 ", 8(%[r])\n\t"                                                                       \
+  "movq " x2 ", 16(%[r])\n\t"                                                                      \
+  "movq " x3 ", 24(%[r])\n\t"
+
+void _fe_modp_mul_adx(fe r, const fe a, const fe b) {
+  // 5 accumulators rotate over the product words, finished low words go to `t`
+  u64 t[4], A, B, C, D, E, lo, hi, z;
+  asm volatile(
+      "movq 0(%[b]), %%rdx\n\t"
+      "mulxq 0(%[a]), %[A], %[B]\n\t"
+      "mulxq 8(%[a]), %[lo], %[C]\n\t"
+      "addq %[lo], %[B]\n\t"
+      "mulxq 16(%[a]), %[lo], %[D]\n\t"
+      "adcq %[lo], %[C]\n\t"
+      "mulxq 24(%[a]), %[lo], %[E]\n\t"
+      "adcq %[lo], %[D]\n\t"
+      "adcq $0, %[E]\n\t"
+      "movq %[A], 0(%[t])\n\t"
+      _FE_ADX_ROW(1, "%[B]", "%[C]", "%[D]", "%[E]", "%[A]")
+      _FE_ADX_ROW(2, "%[C]", "%[D]", "%[E]", "%[A]", "%[B]")
+      _FE_ADX_ROW(3, "%[D]", "%[E]", "%[A]", "%[B]", "%[C]")
+      // 512bit product: t[0..3] E A B C; reduce 512bit -> 288bit into E D A B C
+      "movq $0x1000003D1, %%rdx\n\t"
+      "xorl %k[z], %k[z]\n\t"
+      "mulxq %[E], %[lo], %[hi]\n\t"
+      "movq 0(%[t]), %[E]\n\t"
+      "adoxq %[lo], %[E]\n\t"
+      "movq 8(%[t]), %[D]\n\t"
+      "adcxq %[hi], %[D]\n\t"
+      "mulxq %[A], %[lo], %[hi]\n\t"
+      "adoxq %[lo], %[D]\n\t"
+      "movq 16(%[t]), %[A]\n\t"
+      "adcxq %[hi], %[A]\n\t"
+      "mulxq %[B], %[lo], %[hi]\n\t"
+      "adoxq %[lo], %[A]\n\t"
+      "movq 24(%[t]), %[B]\n\t"
+      "adcxq %[hi], %[B]\n\t"
+      "mulxq %[C], %[lo], %[C]\n\t"
+      "adoxq %[lo], %[B]\n\t"
+      "adcxq %[z], %[C]\n\t"
+      "adoxq %[z], %[C]\n\t"
+      // reduce 288bit -> 256bit
+      _FE_ADX_FOLD("%[E]", "%[D]", "%[A]", "%[B]", "%[C]", "%[lo]", "%[hi]", "%[C]", "%[z]")
+      : [A] "=&r"(A), [B] "=&r"(B), [C] "=&r"(C), [D] "=&r"(D), [E] "=&r"(E), [lo] "=&r"(lo),
+        [hi] "=&r"(hi), [z] "=&r"(z)
+      : [a] "r"(a), [b] "r"(b), [r] "r"(r), [t] "r"(t)
+      : "rdx", "cc", "memory");
+}
+
+void _fe_modp_sqr_adx(fe r, const fe a) {
+  // off-diagonal products once, then doubled (CF chain) while adding diagonals (OF chain)
+  u64 x0, x1, x2, x3, x4, x5, x6, x7, lo, hi, z;
+  asm volatile(
+      "movq 0(%[a]), %%rdx\n\t"
+      "mulxq 8(%[a]), %[x1], %[x2]\n\t"  // a0 * a1
+      "mulxq 16(%[a]), %[lo], %[x3]\n\t" // a0 * a2
+      "addq %[lo], %[x2]\n\t"
+      "mulxq 24(%[a]), %[lo], %[x4]\n\t" // a0 * a3
+      "adcq %[lo], %[x3]\n\t"
+      "adcq $0, %[x4]\n\t"
+      "movq 8(%[a]), %%rdx\n\t"
+      "xorl %k[z], %k[z]\n\t"
+      "mulxq 16(%[a]), %[lo], %[hi]\n\t" // a1 * a2
+      "adoxq %[lo], %[x3]\n\t"
+      "adcxq %[hi], %[x4]\n\t"
+      "mulxq 24(%[a]), %[lo], %[x5]\n\t" // a1 * a3
+      "adoxq %[lo], %[x4]\n\t"
+      "adcxq %[z], %[x5]\n\t"
+      "adoxq %[z], %[x5]\n\t"
+      "movq 16(%[a]), %%rdx\n\t"
+      "mulxq 24(%[a]), %[lo], %[x6]\n\t" // a2 * a3
+      "addq %[lo], %[x5]\n\t"
+      "adcq $0, %[x6]\n\t"
+      // 2 * cross + diagonals
+      "xorl %k[z], %k[z]\n\t"
+      "movq 0(%[a]), %%rdx\n\t"
+      "mulxq %%rdx, %[x0], %[hi]\n\t"
+      "adcxq %[x1], %[x1]\n\t"
+      "adoxq %[hi], %[x1]\n\t"
+      "movq 8(%[a]), %%rdx\n\t"
+      "mulxq %%rdx, %[lo], %[hi]\n\t"
+      "adcxq %[x2], %[x2]\n\t"
+      "adoxq %[lo], %[x2]\n\t"
+      "adcxq %[x3], %[x3]\n\t"
+      "adoxq %[hi], %[x3]\n\t"
+      "movq 16(%[a]), %%rdx\n\t"
+      "mulxq %%rdx, %[lo], %[hi]\n\t"
+      "adcxq %[x4], %[x4]\n\t"
+      "adoxq %[lo], %[x4]\n\t"
+      "adcxq %[x5], %[x5]\n\t"
+      "adoxq %[hi], %[x5]\n\t"
+      "movq 24(%[a]), %%rdx\n\t"
+      "mulxq %%rdx, %[lo], %[x7]\n\t"
+      "adcxq %[x6], %[x6]\n\t"
+      "adoxq %[lo], %[x6]\n\t"
+      "adcxq %[z], %[x7]\n\t"
+      "adoxq %[z], %[x7]\n\t"
+      // reduce 512bit -> 288bit
+      "movq $0x1000003D1, %%rdx\n\t"
+      "xorl %k[z], %k[z]\n\t"
+      "mulxq %[x4], %[lo], %[hi]\n\t"
+      "adoxq %[lo], %[x0]\n\t"
+      "adcxq %[hi], %[x1]\n\t"
+      "mulxq %[x5], %[lo], %[hi]\n\t"
+      "adoxq %[lo], %[x1]\n\t"
+      "adcxq %[hi], %[x2]\n\t"
+      "mulxq %[x6], %[lo], %[hi]\n\t"
+      "adoxq %[lo], %[x2]\n\t"
+      "adcxq %[hi], %[x3]\n\t"
+      "mulxq %[x7], %[lo], %[x4]\n\t"
+      "adoxq %[lo], %[x3]\n\t"
+      "adcxq %[z], %[x4]\n\t"
+      "adoxq %[z], %[x4]\n\t"
+      // reduce 288bit -> 256bit
+      _FE_ADX_FOLD("%[x0]", "%[x1]", "%[x2]", "%[x3]", "%[x4]", "%[x4]", "%[x5]", "%[x6]", "%[x7]")
+      : [x0] "=&r"(x0), [x1] "=&r"(x1), [x2] "=&r"(x2), [x3] "=&r"(x3), [x4] "=&r"(x4),
+        [x5] "=&r"(x5), [x6] "=&r"(x6), [x7] "=&r"(x7), [lo] "=&r"(lo), [hi] "=&r"(hi), [z] "=&r"(z)
+      : [a] "r"(a), [r] "r"(r)
+      : "rdx", "cc", "memory");
+}
+#endif
+
+static bool _fe_use_adx = false;
+__attribute__((constructor)) static void _fe_modp_init() { _fe_use_adx = cpu_has_adx(); }
+
+INLINE void fe_modp_mul(fe r, const fe a, const fe b) {
+#if HAS_X86_ASM
+  if (_fe_use_adx) return _fe_modp_mul_adx(r, a, b);
+#endif
+  _fe_modp_mul_c(r, a, b);
+}
+
+INLINE void fe_modp_sqr(fe r, const fe a) {
+#if HAS_X86_ASM
+  if (_fe_use_adx) return _fe_modp_sqr_adx(r, a);
+#endif
+  _fe_modp_sqr_c(r, a);
+}
+
 void _fe_modp_inv_binpow(fe r, const fe a) {
   // a^(P-2) = a^-1 (mod P)
   // https://e-maxx.ru/algo/reverse_element https://e-maxx.ru/algo/binary_pow
@@ -526,10 +716,223 @@ void _fe_modp_inv_addchn(fe r, const fe a) {
   fe_modp_mul(r, t1, a);
 }
 
-INLINE void fe_modp_inv(fe r, const fe a) { return _fe_modp_inv_addchn(r, a); }
+// MARK: Modulo P inversion (safegcd)
+// https://gcd.cr.yp.to/safegcd-20190413.pdf
+// https://github.com/bitcoin-core/secp256k1/blob/master/src/modinv64_impl.h
+//
+// Bernstein-Yang divsteps in batches of 62: each batch works on the low 64 bits of f, g only and
+// produces a 2x2 transition matrix, which is then applied to full-width f, g (and d, e, that
+// track the inverse). Variable time, ~10 batches for 256bit input.
+
+typedef int64_t fe62[5]; // 256bit as 5x62bit signed limbs (a0 + a1*2^62 + .. + a4*2^248)
+typedef struct fe62_trans_t {
+  int64_t u, v, q, r;
+} fe62_trans_t;
+
+#define FE62_M (UINT64_MAX >> 2)                 // 62bit limb mask
+GLOBAL fe62 FE62_P = {-0x1000003D1LL, 0, 0, 0, 256}; // P in signed 62bit limbs
+GLOBAL u64 FE62_P_INV = 0x27C7F6E22DDACACFULL;       // 1 / P mod 2^62
+
+INLINE void fe62_from_fe(fe62 r, const fe a) {
+  r[0] = a[0] & FE62_M;
+  r[1] = (a[0] >> 62 | a[1] << 2) & FE62_M;
+  r[2] = (a[1] >> 60 | a[2] << 4) & FE62_M;
+  r[3] = (a[2] >> 58 | a[3] << 6) & FE62_M;
+  r[4] = a[3] >> 56;
+}
+
+INLINE void fe62_to_fe(fe r, const fe62 a) { // a should be normalized to [0, P)
+  r[0] = (u64)a[0] | (u64)a[1] << 62;
+  r[1] = (u64)a[1] >> 2 | (u64)a[2] << 60;
+  r[2] = (u64)a[2] >> 4 | (u64)a[3] << 58;
+  r[3] = (u64)a[3] >> 6 | (u64)a[4] << 56;
+}
+
+int64_t _fe62_divsteps(int64_t eta, u64 f0, u64 g0, fe62_trans_t *t) {
+  // 62 divsteps on the low bits of f & g; eta = -delta (starts with -1)
+  // [f g] * 2^62 = t * [f0 g0] on exit
+  u64 u = 1, v = 0, q = 0, r = 1, f = f0, g = g0, m, w;
+  int i = 62, limit, zeros;
+
+  while (true) {
+    // skip all zero bits of g at once (each one is a divstep with g even)
+    zeros = __builtin_ctzll(g | (UINT64_MAX << i));
+    g >>= zeros, u <<= zeros, v <<= zeros;
+    eta -= zeros, i -= zeros;
+    if (i == 0) break;
+
+    if (eta < 0) { // delta > 0 and g odd: swap (f, g) = (g, -f)
+      u64 tmp;
+      eta = -eta;
+      tmp = f, f = g, g = -tmp;
+      tmp = u, u = q, q = -tmp;
+      tmp = v, v = r, r = -tmp;
+
+      // eliminate up to 6 bits of g at once: w = -g / f mod 2^limit
+      limit = MIN((int)eta + 1, i);
+      m = (UINT64_MAX >> (64 - limit)) & 63U;
+      w = (f * g * (f * f - 2)) & m;
+    } else {
+      // eliminate up to 4 bits of g at once
+      limit = MIN((int)eta + 1, i);
+      m = (UINT64_MAX >> (64 - limit)) & 15U;
+      w = f + (((f + 1) & 4) << 1);
+      w = (-w * g) & m;
+    }
+
+    g += f * w;
+    q += u * w;
+    r += v * w;
+  }
+
+  t->u = (int64_t)u, t->v = (int64_t)v, t->q = (int64_t)q, t->r = (int64_t)r;
+  return eta;
+}
+
+void _fe62_update_de(fe62 d, fe62 e, const fe62_trans_t *t) {
+  // [d e] = t * [d e] / 2^62 (mod P); P multiple is added to make low 62 bits zero
+  const int64_t u = t->u, v = t->v, q = t->q, r = t->r;
+  int64_t sd = d[4] >> 63, se = e[4] >> 63; // signs of d & e
+  int64_t md = (u & sd) + (v & se), me = (q & sd) + (r & se);
+  i128 cd, ce;
+
+  cd = (i128)u * d[0] + (i128)v * e[0];
+  ce = (i128)q * d[0] + (i128)r * e[0];
+  md -= (FE62_P_INV * (u64)cd + md) & FE62_M;
+  me -= (FE62_P_INV * (u64)ce + me) & FE62_M;
+  cd += (i128)FE62_P[0] * md;
+  ce += (i128)FE62_P[0] * me;
+  cd >>= 62, ce >>= 62; // low 62 bits are zero now
+
+  // P[1..3] are zero
+  for (int i = 1; i < 4; ++i) {
+    cd += (i128)u * d[i] + (i128)v * e[i];
+    ce += (i128)q * d[i] + (i128)r * e[i];
+    d[i - 1] = (u64)cd & FE62_M, cd >>= 62;
+    e[i - 1] = (u64)ce & FE62_M, ce >>= 62;
+  }
+
+  cd += (i128)u * d[4] + (i128)v * e[4] + (i128)FE62_P[4] * md;
+  ce += (i128)q * d[4] + (i128)r * e[4] + (i128)FE62_P[4] * me;
+  d[3] = (u64)cd & FE62_M, cd >>= 62;
+  e[3] = (u64)ce & FE62_M, ce >>= 62;
+  d[4] = (int64_t)cd;
+  e[4] = (int64_t)ce;
+}
+
+void _fe62_update_fg(fe62 f, fe62 g, const fe62_trans_t *t, const int len) {
+  // [f g] = t * [f g] / 2^62 (exact), only first `len` limbs are used
+  const int64_t u = t->u, v = t->v, q = t->q, r = t->r;
+  i128 cf, cg;
+
+  cf = (i128)u * f[0] + (i128)v * g[0];
+  cg = (i128)q * f[0] + (i128)r * g[0];
+  cf >>= 62, cg >>= 62;
+
+  for (int i = 1; i < len; ++i) {
+    cf += (i128)u * f[i] + (i128)v * g[i];
+    cg += (i128)q * f[i] + (i128)r * g[i];
+    f[i - 1] = (u64)cf & FE62_M, cf >>= 62;
+    g[i - 1] = (u64)cg & FE62_M, cg >>= 62;
+  }
+
+  f[len - 1] = (int64_t)cf;
+  g[len - 1] = (int64_t)cg;
+}
+
+void _fe62_normalize(fe62 r, const int64_t sign) {
+  // r from (-2P, P) to [0, P), negated if sign < 0
+  int64_t r0 = r[0], r1 = r[1], r2 = r[2], r3 = r[3], r4 = r[4], cond;
+
+  cond = r4 >> 63; // add P if negative
+  r0 += FE62_P[0] & cond, r4 += FE62_P[4] & cond;
+  cond = sign >> 63; // negate if requested
+  r0 = (r0 ^ cond) - cond, r1 = (r1 ^ cond) - cond, r2 = (r2 ^ cond) - cond;
+  r3 = (r3 ^ cond) - cond, r4 = (r4 ^ cond) - cond;
+  r1 += r0 >> 62, r0 &= FE62_M;
+  r2 += r1 >> 62, r1 &= FE62_M;
+  r3 += r2 >> 62, r2 &= FE62_M;
+  r4 += r3 >> 62, r3 &= FE62_M;
+
+  cond = r4 >> 63; // still negative: add P once more
+  r0 += FE62_P[0] & cond, r4 += FE62_P[4] & cond;
+  r1 += r0 >> 62, r0 &= FE62_M;
+  r2 += r1 >> 62, r1 &= FE62_M;
+  r3 += r2 >> 62, r2 &= FE62_M;
+  r4 += r3 >> 62, r3 &= FE62_M;
+
+  r[0] = r0, r[1] = r1, r[2] = r2, r[3] = r3, r[4] = r4;
+}
+
+void _fe_modp_inv_safegcd(fe r, const fe a) {
+  fe62 d = {0}, e = {1}, f, g;
+  memcpy(f, FE62_P, sizeof(fe62));
+  fe62_from_fe(g, a);
+
+  int64_t eta = -1, fn, gn, cond;
+  int len = 5;
+
+  while (true) {
+    fe62_trans_t t;
+    eta = _fe62_divsteps(eta, f[0], g[0], &t);
+    _fe62_update_de(d, e, &t);
+    _fe62_update_fg(f, g, &t, len);
+
+    if (g[0] == 0) { // g = 0: done, f = +-1 and d = +-1/a
+      cond = 0;
+      for (int j = 1; j < len; ++j) cond |= g[j];
+      if (cond == 0) break;
+    }
 
-void fe_modp_grpinv(fe r[], const u32 n) {
-  fe *zs = (fe *)malloc(n * sizeof(fe));
+    // both f & g top limbs are 0 or -1: shrink length (they fit in fewer limbs)
+    fn = f[len - 1], gn = g[len - 1];
+    cond = ((int64_t)len - 2) >> 63;
+    cond |= fn ^ (fn >> 63);
+    cond |= gn ^ (gn >> 63);
+    if (cond == 0) {
+      f[len - 2] |= (u64)fn << 62;
+      g[len - 2] |= (u64)gn << 62;
+      len -= 1;
+    }
+  }
+
+  _fe62_normalize(d, f[len - 1]);
+  fe62_to_fe(r, d);
+}
+
+INLINE void fe_modp_inv(fe r, const fe a) { return _fe_modp_inv_safegcd(r, a); }
+
+// MARK: Scratch workspace
+// Per-thread buffers for batch routines (group inversion & reduction), so they do not call
+// malloc on every group. Create one per worker (zero-initialized), buffers grow on first use
+// and are reused after that; release with ec_ws_free.
+
+typedef struct ec_ws_t {
+  fe *zs;     // prefix products (fe_modp_grpinv)
+  fe *zz;     // inverted z coordinates (ec_jacobi_grprdc)
+  size_t cap; // capacity of each buffer (in field elements)
+} ec_ws_t;
+
+void ec_ws_reserve(ec_ws_t *ws, const size_t n) {
+  if (n <= ws->cap) return;
+  ws->zs = (fe *)realloc(ws->zs, n * sizeof(fe));
+  ws->zz = (fe *)realloc(ws->zz, n * sizeof(fe));
+  if (ws->zs == NULL || ws->zz == NULL) {
+    fprintf(stderr, "failed to allocate scratch workspace\n");
+    exit(1);
+  }
+  ws->cap = n;
+}
+
+void ec_ws_free(ec_ws_t *ws) {
+  free(ws->zs);
+  free(ws->zz);
+  memset(ws, 0, sizeof(ec_ws_t));
+}
+
+void fe_modp_grpinv(fe r[], const u32 n, ec_ws_t *ws) {
+  ec_ws_reserve(ws, n);
+  fe *zs = ws->zs;
 
   fe_clone(*zs, r[0]);
   for (u32 i = 1; i < n; ++i) fe_modp_mul(*(zs + i), *(zs + (i - 1)), r[i]);
@@ -545,7 +948,176 @@ void fe_modp_grpinv(fe r[], const u32 n) {
   }
 
   fe_clone(r[0], t1);
-  free(zs);
+}
+
+// MARK: Modulo P arithmetic (5x52)
+// https://github.com/bitcoin-core/secp256k1/blob/master/src/field_5x52_int128_impl.h
+//
+// Unsaturated representation: 256bit as 5x52bit (a0 + a1*2^52 + a2*2^104 + a3*2^156 + a4*2^208)
+// with 12 spare bits per limb, so add / sub / neg do no carry propagation at all. Each value has
+// a "magnitude" m (limbs are at most 2*m*(2^52-1)), which grows with every add / sub. mul / sqr
+// accept inputs with magnitude <= 8 and always return magnitude 1. Values are normalized only on
+// conversion back to `fe`. Enabled at build time with `-DUSE_FE52` (`make build FE52=1`).
+
+#ifndef USE_FE52
+  #define USE_FE52 0
+#endif
+
+typedef u64 fe52[5];
+
+#define FE52_M 0xFFFFFFFFFFFFFULL // 52bit limb mask
+#define FE52_R 0x1000003D10ULL    // 2^260 mod P
+
+INLINE void fe52_from_fe(fe52 r, const fe a) {
+  r[0] = a[0] & FE52_M;
+  r[1] = (a[0] >> 52 | a[1] << 12) & FE52_M;
+  r[2] = (a[1] >> 40 | a[2] << 24) & FE52_M;
+  r[3] = (a[2] >> 28 | a[3] << 36) & FE52_M;
+  r[4] = a[3] >> 16;
+}
+
+INLINE void fe52_normalize(fe52 r) {
+  u64 t0 = r[0], t1 = r[1], t2 = r[2], t3 = r[3], t4 = r[4], m, x;
+
+  // reduce t4 first, so there will be at most a single carry from the first pass
+  x = t4 >> 48;
+  t4 &= 0x0FFFFFFFFFFFFULL;
+
+  t0 += x * 0x1000003D1ULL;
+  t1 += t0 >> 52, t0 &= FE52_M;
+  t2 += t1 >> 52, t1 &= FE52_M, m = t1;
+  t3 += t2 >> 52, t2 &= FE52_M, m &= t2;
+  t4 += t3 >> 52, t3 &= FE52_M, m &= t3;
+
+  // at most one final reduction is needed: if value >= P (or carried to bit 256)
+  x = (t4 >> 48) | ((t4 == 0x0FFFFFFFFFFFFULL) & (m == FE52_M) & (t0 >= 0xFFFFEFFFFFC2FULL));
+  t0 += x * 0x1000003D1ULL;
+  t1 += t0 >> 52, t0 &= FE52_M;
+  t2 += t1 >> 52, t1 &= FE52_M;
+  t3 += t2 >> 52, t2 &= FE52_M;
+  t4 += t3 >> 52, t3 &= FE52_M;
+  t4 &= 0x0FFFFFFFFFFFFULL;
+
+  r[0] = t0, r[1] = t1, r[2] = t2, r[3] = t3, r[4] = t4;
+}
+
+INLINE void fe52_to_fe(fe r, const fe52 a) {
+  fe52 t;
+  memcpy(t, a, sizeof(fe52));
+  fe52_normalize(t);
+  r[0] = t[0] | t[1] << 52;
+  r[1] = t[1] >> 12 | t[2] << 40;
+  r[2] = t[2] >> 24 | t[3] << 28;
+  r[3] = t[3] >> 36 | t[4] << 16;
+}
+
+INLINE bool fe52_iszero(const fe52 a) {
+  fe t;
+  fe52_to_fe(t, a);
+  return fe_iszero(t);
+}
+
+INLINE void fe52_add(fe52 r, const fe52 a, const fe52 b) { // magnitude: ma + mb
+  r[0] = a[0] + b[0];
+  r[1] = a[1] + b[1];
+  r[2] = a[2] + b[2];
+  r[3] = a[3] + b[3];
+  r[4] = a[4] + b[4];
+}
+
+INLINE void fe52_neg(fe52 r, const fe52 a, const u32 m) { // r = -a; magnitude: m + 1
+  // 2 * (m + 1) * P - a, limbs of P are 0xFFFFEFFFFFC2F, 0xFFFFFFFFFFFFF x3, 0x0FFFFFFFFFFFF
+  r[0] = 0xFFFFEFFFFFC2FULL * 2 * (m + 1) - a[0];
+  r[1] = 0xFFFFFFFFFFFFFULL * 2 * (m + 1) - a[1];
+  r[2] = 0xFFFFFFFFFFFFFULL * 2 * (m + 1) - a[2];
+  r[3] = 0xFFFFFFFFFFFFFULL * 2 * (m + 1) - a[3];
+  r[4] = 0x0FFFFFFFFFFFFULL * 2 * (m + 1) - a[4];
+}
+
+INLINE void fe52_sub(fe52 r, const fe52 a, const fe52 b, const u32 mb) { // ma + mb + 1
+  fe52 t;
+  fe52_neg(t, b, mb);
+  fe52_add(r, a, t);
+}
+
+void fe52_mul(fe52 r, const fe52 a, const fe52 b) {
+  // [... a b c] is a shorthand for ... + a<<104 + b<<52 + c<<0 mod P
+  // px is a shorthand for sum(a[i]*b[x-i]); note that [x 0 0 0 0 0] = [x*R]
+  const u64 a0 = a[0], a1 = a[1], a2 = a[2], a3 = a[3], a4 = a[4];
+  const u64 b0 = b[0], b1 = b[1], b2 = b[2], b3 = b[3], b4 = b[4];
+  u128 c, d;
+  u64 t3, t4, tx, u0;
+
+  d = (u128)a0 * b3 + (u128)a1 * b2 + (u128)a2 * b1 + (u128)a3 * b0; // [d 0 0 0] = [p3 0 0 0]
+  c = (u128)a4 * b4;                                                  // [c 0 0 0 0 d 0 0 0]
+  d += (u128)FE52_R * (u64)c, c >>= 64;                               // [(c<<12) 0 0 0 0 0 d 0 0 0]
+  t3 = d & FE52_M, d >>= 52;                                          // [(c<<12) 0 0 0 0 d t3 0 0 0]
+
+  d += (u128)a0 * b4 + (u128)a1 * b3 + (u128)a2 * b2 + (u128)a3 * b1 + (u128)a4 * b0;
+  d += (u128)(FE52_R << 12) * (u64)c; // [d t3 0 0 0] = [p8 0 0 0 p4 p3 0 0 0]
+  t4 = d & FE52_M, d >>= 52;          // [d t4 t3 0 0 0]
+  tx = t4 >> 48, t4 &= (FE52_M >> 4); // [d t4+(tx<<48) t3 0 0 0]
+
+  c = (u128)a0 * b0;                                                  // [d t4+(tx<<48) t3 0 0 c]
+  d += (u128)a1 * b4 + (u128)a2 * b3 + (u128)a3 * b2 + (u128)a4 * b1; // + p5
+  u0 = d & FE52_M, d >>= 52;                                          // [d u0 t4+(tx<<48) t3 0 0 c]
+  u0 = (u0 << 4) | tx;                                                // [d 0 t4+(u0<<48) t3 0 0 c]
+  c += (u128)u0 * (FE52_R >> 4);                                      // [d 0 t4 t3 0 0 c]
+  r[0] = c & FE52_M, c >>= 52;                                        // [d 0 t4 t3 0 c r0]
+
+  c += (u128)a0 * b1 + (u128)a1 * b0;                 // + p1
+  d += (u128)a2 * b4 + (u128)a3 * b3 + (u128)a4 * b2; // + p6
+  c += (u128)(d & FE52_M) * FE52_R, d >>= 52;         // [d 0 0 t4 t3 0 c r0]
+  r[1] = c & FE52_M, c >>= 52;                        // [d 0 0 t4 t3 c r1 r0]
+
+  c += (u128)a0 * b2 + (u128)a1 * b1 + (u128)a2 * b0; // + p2
+  d += (u128)a3 * b4 + (u128)a4 * b3;                 // + p7
+  c += (u128)FE52_R * (u64)d, d >>= 64;               // [(d<<12) 0 0 0 t4 t3 c r1 r0]
+  r[2] = c & FE52_M, c >>= 52;                        // [(d<<12) 0 0 0 t4 t3+c r2 r1 r0]
+
+  c += (u128)(FE52_R << 12) * (u64)d + t3; // [t4 c r2 r1 r0]
+  r[3] = c & FE52_M, c >>= 52;             // [t4+c r3 r2 r1 r0]
+  r[4] = c + t4;                           // [r4 r3 r2 r1 r0]
+}
+
+void fe52_sqr(fe52 r, const fe52 a) {
+  // same as fe52_mul, but symmetric products are computed once and doubled
+  u64 a0 = a[0], a1 = a[1], a2 = a[2], a3 = a[3], a4 = a[4];
+  u128 c, d;
+  u64 t3, t4, tx, u0;
+
+  d = (u128)(a0 * 2) * a3 + (u128)(a1 * 2) * a2; // [d 0 0 0] = [p3 0 0 0]
+  c = (u128)a4 * a4;                             // [c 0 0 0 0 d 0 0 0]
+  d += (u128)FE52_R * (u64)c, c >>= 64;          // [(c<<12) 0 0 0 0 0 d 0 0 0]
+  t3 = d & FE52_M, d >>= 52;                     // [(c<<12) 0 0 0 0 d t3 0 0 0]
+
+  a4 *= 2;
+  d += (u128)a0 * a4 + (u128)(a1 * 2) * a3 + (u128)a2 * a2;
+  d += (u128)(FE52_R << 12) * (u64)c; // [d t3 0 0 0] = [p8 0 0 0 p4 p3 0 0 0]
+  t4 = d & FE52_M, d >>= 52;          // [d t4 t3 0 0 0]
+  tx = t4 >> 48, t4 &= (FE52_M >> 4); // [d t4+(tx<<48) t3 0 0 0]
+
+  c = (u128)a0 * a0;                           // [d t4+(tx<<48) t3 0 0 c]
+  d += (u128)a1 * a4 + (u128)(a2 * 2) * a3;    // + p5
+  u0 = d & FE52_M, d >>= 52;                   // [d u0 t4+(tx<<48) t3 0 0 c]
+  u0 = (u0 << 4) | tx;                         // [d 0 t4+(u0<<48) t3 0 0 c]
+  c += (u128)u0 * (FE52_R >> 4);               // [d 0 t4 t3 0 0 c]
+  r[0] = c & FE52_M, c >>= 52;                 // [d 0 t4 t3 0 c r0]
+
+  a0 *= 2;
+  c += (u128)a0 * a1;                          // + p1
+  d += (u128)a2 * a4 + (u128)a3 * a3;          // + p6
+  c += (u128)(d & FE52_M) * FE52_R, d >>= 52;  // [d 0 0 t4 t3 0 c r0]
+  r[1] = c & FE52_M, c >>= 52;                 // [d 0 0 t4 t3 c r1 r0]
+
+  c += (u128)a0 * a2 + (u128)a1 * a1;          // + p2
+  d += (u128)a3 * a4;                          // + p7
+  c += (u128)FE52_R * (u64)d, d >>= 64;        // [(d<<12) 0 0 0 t4 t3 c r1 r0]
+  r[2] = c & FE52_M, c >>= 52;                 // [(d<<12) 0 0 0 t4 t3+c r2 r1 r0]
+
+  c += (u128)(FE52_R << 12) * (u64)d + t3;     // [t4 c r2 r1 r0]
+  r[3] = c & FE52_M, c >>= 52;                 // [t4+c r3 r2 r1 r0]
+  r[4] = c + t4;                               // [r4 r3 r2 r1 r0]
 }
 
 // MARK: EC Point
@@ -575,6 +1147,16 @@ INLINE void pe_clone(pe *r, const pe *a) {
   // fe_clone(r->z, a->z);
 }
 
+// batch of affine points in SoA layout: x[] and y[] are separate arrays, z = 1 is implied
+typedef struct pe_batch_t {
+  fe *x;
+  fe *y;
+} pe_batch_t;
+
+INLINE pe_batch_t pe_batch_at(const pe_batch_t b, const size_t i) {
+  return (pe_batch_t){.x = b.x + i, .y = b.y + i};
+}
+
 // https://en.wikibooks.org/wiki/Cryptography/Prime_Curve/Affine_Coordinates
 
 void ec_affine_dbl(pe *r, const pe *p) {
@@ -615,6 +1197,37 @@ void ec_affine_add(pe *r, const pe *p, const pe *q) {
   fe_clone(r->x, t3);
 }
 
+// r = p + q, where inv = 1 / (qx - px) is already known (eg. from group inversion)
+INLINE void ec_affine_add_inv(fe rx, fe ry, const fe px, const fe py, const fe qx, const fe qy,
+                              const fe inv) {
+#if USE_FE52
+  fe52 x1, y1, x2, y2, l, t, d;
+  fe52_from_fe(x1, px), fe52_from_fe(y1, py);
+  fe52_from_fe(x2, qx), fe52_from_fe(y2, qy), fe52_from_fe(l, inv);
+  fe52_sub(t, y2, y1, 1); // y2 - y1                [3]
+  fe52_mul(l, t, l);      // λ = (y2 - y1) / (x2 - x1)
+  fe52_sqr(t, l);         // λ^2                    [1]
+  fe52_sub(t, t, x1, 1);  // λ^2 - x1               [3]
+  fe52_sub(t, t, x2, 1);  // rx = λ^2 - x1 - x2     [5]
+  fe52_sub(d, x1, t, 5);  // x1 - rx                [7]
+  fe52_mul(d, l, d);      // λ * (x1 - rx)          [1]
+  fe52_to_fe(rx, t);
+  fe52_sub(d, d, y1, 1);  // ry = λ * (x1 - rx) - y1 [3]
+  fe52_to_fe(ry, d);
+#else
+  fe l, t, d;
+  fe_modp_sub(l, qy, py); // y2 - y1
+  fe_modp_mul(l, l, inv); // λ = (y2 - y1) / (x2 - x1)
+  fe_modp_sqr(t, l);      // λ^2
+  fe_modp_sub(t, t, px);  // λ^2 - x1
+  fe_modp_sub(t, t, qx);  // rx = λ^2 - x1 - x2
+  fe_modp_sub(d, px, t);  // x1 - rx
+  fe_modp_mul(d, l, d);   // λ * (x1 - rx)
+  fe_modp_sub(ry, d, py); // ry = λ * (x1 - rx) - y1
+  fe_clone(rx, t);
+#endif
+}
+
 // https://en.wikibooks.org/wiki/Cryptography/Prime_Curve/Standard_Projective_Coordinates
 
 void _ec_jacobi_dbl1(pe *r, const pe *p) {
@@ -692,6 +1305,39 @@ void _ec_jacobi_add1(pe *r, const pe *p, const pe *q) {
   fe_modp_sub(r->y, a, u);     // y3 = u * (v^2 * v2 - a) - v^3 * u2
 }
 
+void _ec_jacobi_add52(pe *r, const pe *p, const pe *q) {
+  // same as _ec_jacobi_add1, but with lazy reduction in 5x52 (magnitudes in brackets)
+  fe52 px, py, pz, qx, qy, qz, u2, v2, u, v, w, a, vs, vc, t;
+  fe52_from_fe(px, p->x), fe52_from_fe(py, p->y), fe52_from_fe(pz, p->z);
+  fe52_from_fe(qx, q->x), fe52_from_fe(qy, q->y), fe52_from_fe(qz, q->z);
+
+  fe52_mul(u2, py, qz);  // u2 = py * qz                        [1]
+  fe52_mul(v2, px, qz);  // v2 = px * qz                        [1]
+  fe52_mul(u, qy, pz);   // u1 = qy * pz                        [1]
+  fe52_mul(v, qx, pz);   // v1 = qx * pz                        [1]
+  fe52_mul(w, pz, qz);   // w = pz * qz                         [1]
+  fe52_sub(u, u, u2, 1); // u = u1 - u2                         [3]
+  fe52_sub(v, v, v2, 1); // v = v1 - v2                         [3]
+  assert(!fe52_iszero(v));
+  fe52_sqr(vs, v);       // v^2                                 [1]
+  fe52_mul(vc, vs, v);   // v^3                                 [1]
+  fe52_mul(vs, vs, v2);  // v^2 * v2                            [1]
+  fe52_mul(t, vc, w);    // z3 = v^3 * w                        [1]
+  fe52_sqr(a, u);        // u^2                                 [1]
+  fe52_mul(a, a, w);     // u^2 * w                             [1]
+  fe52_add(w, vs, vs);   // 2 * v^2 * v2                        [2]
+  fe52_sub(a, a, vc, 1); // u^2 * w - v^3                       [3]
+  fe52_sub(a, a, w, 2);  // u^2 * w - v^3 - 2 * v^2 * v2        [6]
+  fe52_to_fe(r->z, t);
+  fe52_mul(t, v, a);     // x3 = v * a                          [1]
+  fe52_to_fe(r->x, t);
+  fe52_sub(a, vs, a, 6); // v^2 * v2 - a                        [8]
+  fe52_mul(a, a, u);     // u * (v^2 * v2 - a)                  [1]
+  fe52_mul(u, vc, u2);   // v^3 * u2                            [1]
+  fe52_sub(t, a, u, 1);  // y3 = u * (v^2 * v2 - a) - v^3 * u2  [3]
+  fe52_to_fe(r->y, t);
+}
+
 void _ec_jacobi_rdc1(pe *r, const pe *a) {
   // reduce Standard Projective to Affine
   fe_clone(r->z, a->z);
@@ -701,18 +1347,17 @@ void _ec_jacobi_rdc1(pe *r, const pe *a) {
   fe_set64(r->z, 0x1);
 }
 
-void _ec_jacobi_grprdc1(pe r[], u64 n) {
-  fe *zz = (fe *)malloc(n * sizeof(fe));
+void _ec_jacobi_grprdc1(pe r[], u64 n, ec_ws_t *ws) {
+  ec_ws_reserve(ws, n);
+  fe *zz = ws->zz;
   for (u64 i = 0; i < n; ++i) fe_clone(zz[i], r[i].z);
-  fe_modp_grpinv(zz, n);
+  fe_modp_grpinv(zz, n, ws);
 
   for (u64 i = 0; i < n; ++i) {
     fe_modp_mul(r[i].x, r[i].x, zz[i]);
     fe_modp_mul(r[i].y, r[i].y, zz[i]);
     fe_set64(r[i].z, 0x1);
   }
-
-  free(zz);
 }
 
 // https://en.wikibooks.org/wiki/Cryptography/Prime_Curve/Jacobian_Coordinates
@@ -797,10 +1442,11 @@ void _ec_jacobi_rdc2(pe *r, const pe *a) {
   fe_set64(r->z, 0x1);
 }
 
-void _ec_jacobi_grprdc2(pe r[], u64 n) {
-  fe *zz = (fe *)malloc(n * sizeof(fe));
+void _ec_jacobi_grprdc2(pe r[], u64 n, ec_ws_t *ws) {
+  ec_ws_reserve(ws, n);
+  fe *zz = ws->zz;
   for (u64 i = 0; i < n; ++i) fe_clone(zz[i], r[i].z);
-  fe_modp_grpinv(zz, n);
+  fe_modp_grpinv(zz, n, ws);
 
   fe z = {0};
   for (u64 i = 0; i < n; ++i) {
@@ -810,8 +1456,6 @@ void _ec_jacobi_grprdc2(pe r[], u64 n) {
     fe_modp_mul(r[i].y, r[i].y, z); // y = y * z^3
     fe_set64(r[i].z, 0x1);
   }
-
-  free(zz);
 }
 
 // v1. add: ~6.6M it/s, dbl: ~5.6M it/s
@@ -819,13 +1463,19 @@ void _ec_jacobi_grprdc2(pe r[], u64 n) {
 // v1 is used because add operation is more frequent
 
 INLINE void ec_jacobi_dbl(pe *r, const pe *p) { return _ec_jacobi_dbl1(r, p); }
-INLINE void ec_jacobi_add(pe *r, const pe *p, const pe *q) { return _ec_jacobi_add1(r, p, q); }
+INLINE void ec_jacobi_add(pe *r, const pe *p, const pe *q) {
+#if USE_FE52
+  return _ec_jacobi_add52(r, p, q);
+#else
+  return _ec_jacobi_add1(r, p, q);
+#endif
+}
 INLINE void ec_jacobi_rdc(pe *r, const pe *a) { return _ec_jacobi_rdc1(r, a); }
-INLINE void ec_jacobi_grprdc(pe r[], u64 n) { return _ec_jacobi_grprdc1(r, n); }
+INLINE void ec_jacobi_grprdc(pe r[], u64 n, ec_ws_t *ws) { return _ec_jacobi_grprdc1(r, n, ws); }
 // INLINE void ec_jacobi_dbl(pe *r, const pe *p) { return _ec_jacobi_dbl2(r, p); }
 // INLINE void ec_jacobi_add(pe *r, const pe *p, const pe *q) { return _ec_jacobi_add2(r, p, q); }
 // INLINE void ec_jacobi_rdc(pe *r, const pe *a) { return _ec_jacobi_rdc2(r, a); }
-// INLINE void ec_jacobi_grprdc(pe r[], u64 n) { return _ec_jacobi_grprdc2(r, n); }
+// INLINE void ec_jacobi_grprdc(pe r[], u64 n, ec_ws_t *ws) { return _ec_jacobi_grprdc2(r, n, ws); }
 
 void ec_jacobi_mul(pe *r, const pe *p, const fe k) {
   // double-and-add in Jacobian space
@@ -884,6 +1534,8 @@ bool ec_verify(const pe *p) {
 
 u64 _GTABLE_W = 14;
 pe *_gtable = NULL; // GTable for precomputed points
+size_t _gtable_size = 0;
+hp_kind _gtable_mem = HP_HEAP;
 
 // https://www.sav.sk/journals/uploads/0215094304C459.pdf (Algorithm 3)
 size_t ec_gtable_init() {
@@ -892,8 +1544,13 @@ size_t ec_gtable_init() {
   u64 s = n * d - d;
 
   size_t mem_size = s * sizeof(pe);
-  if (_gtable != NULL) free(_gtable);
-  _gtable = (pe *)malloc(mem_size);
+  hp_free(_gtable, _gtable_size, _gtable_mem);
+  _gtable = (pe *)hp_alloc(mem_size, &_gtable_mem);
+  _gtable_size = mem_size;
+  if (_gtable == NULL) {
+    fprintf(stderr, "failed to allocate gtable (%'zu bytes)\n", mem_size);
+    exit(1);
+  }
 
   pe b, p;
   pe_clone(&b, &G1);
@@ -909,7 +1566,9 @@ size_t ec_gtable_init() {
     ec_jacobi_add(&b, &p, &b);
   }
 
-  ec_jacobi_grprdc(_gtable, s);
+  ec_ws_t ws = {0};
+  ec_jacobi_grprdc(_gtable, s, &ws);
+  ec_ws_free(&ws);
   return mem_size;
 }
 
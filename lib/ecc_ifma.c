@@ -0,0 +1,173 @@
+// Copyright (c) vladkens
+// https://github.com/vladkens/ecloop
+// Licensed under the MIT License.
+
+#pragma once
+#include "ecc.c"
+
+// MARK: AVX-512 IFMA
+// 8 field elements at once in SoA layout: zmm register k holds limb k (52bit, as in fe52) of all
+// 8 lanes. Products are accumulated with vpmadd52luq / vpmadd52huq, which use only the low 52
+// bits of each operand, so every mul input must have its carries propagated first.
+
+#if HAS_X86_ASM
+  #include <immintrin.h>
+
+  #define IFMA_FN static inline __attribute__((always_inline, target("avx512f,avx512ifma")))
+  #define IFMA_TARGET __attribute__((target("avx512f,avx512ifma")))
+
+typedef __m512i fe8[5];
+
+static bool _ec_use_ifma = false;
+__attribute__((constructor)) static void _ec_ifma_init() { _ec_use_ifma = cpu_has_avx512ifma(); }
+
+  #define FE8_LO(acc, a, b) acc = _mm512_madd52lo_epu64(acc, a, b)
+  #define FE8_HI(acc, a, b) acc = _mm512_madd52hi_epu64(acc, a, b)
+  #define FE8_MAC(lo, hi, a, b) FE8_LO(lo, a, b), FE8_HI(hi, a, b)
+  #define FE8_CARRY(a, b) b = _mm512_add_epi64(b, _mm512_srli_epi64(a, 52)), a = _mm512_and_si512(a, M)
+
+IFMA_FN void fe8_carry(fe8 r) { // limbs to 52bit (value itself is not reduced)
+  const __m512i M = _mm512_set1_epi64(FE52_M);
+  FE8_CARRY(r[0], r[1]);
+  FE8_CARRY(r[1], r[2]);
+  FE8_CARRY(r[2], r[3]);
+  FE8_CARRY(r[3], r[4]);
+}
+
+IFMA_FN void fe8_fold256(fe8 r) { // move bits above 2^256 to the bottom; limb 4 ends <= 2^48
+  const __m512i C = _mm512_set1_epi64(0x1000003D1ULL);
+  __m512i x = _mm512_srli_epi64(r[4], 48);
+  r[4] = _mm512_and_si512(r[4], _mm512_set1_epi64(0x0FFFFFFFFFFFFULL));
+  FE8_LO(r[0], x, C);
+  fe8_carry(r);
+}
+
+IFMA_FN void fe8_normalize(fe8 r) { // fully reduce to [0, P)
+  const __m512i M = _mm512_set1_epi64(FE52_M);
+  const __m512i M48 = _mm512_set1_epi64(0x0FFFFFFFFFFFFULL);
+  fe8_carry(r);
+  fe8_fold256(r);
+
+  // at most one P to subtract: if carried to bit 256 or limbs are >= P
+  __m512i m = _mm512_and_si512(_mm512_and_si512(r[1], r[2]), r[3]);
+  __mmask8 ge = _mm512_cmpgt_epu64_mask(r[4], M48);
+  ge |= _mm512_cmpeq_epu64_mask(r[4], M48) & _mm512_cmpeq_epu64_mask(m, M) &
+        _mm512_cmpge_epu64_mask(r[0], _mm512_set1_epi64(0xFFFFEFFFFFC2FULL));
+  r[0] = _mm512_mask_add_epi64(r[0], ge, r[0], _mm512_set1_epi64(0x1000003D1ULL));
+  fe8_carry(r);
+  r[4] = _mm512_and_si512(r[4], M48);
+}
+
+IFMA_FN void fe8_sub(fe8 r, const fe8 a, const fe8 b) { // r = a + 2P - b, b limbs <= 2 * P limbs
+  r[0] = _mm512_sub_epi64(_mm512_add_epi64(a[0], _mm512_set1_epi64(0xFFFFEFFFFFC2FULL * 2)), b[0]);
+  r[1] = _mm512_sub_epi64(_mm512_add_epi64(a[1], _mm512_set1_epi64(0xFFFFFFFFFFFFFULL * 2)), b[1]);
+  r[2] = _mm512_sub_epi64(_mm512_add_epi64(a[2], _mm512_set1_epi64(0xFFFFFFFFFFFFFULL * 2)), b[2]);
+  r[3] = _mm512_sub_epi64(_mm512_add_epi64(a[3], _mm512_set1_epi64(0xFFFFFFFFFFFFFULL * 2)), b[3]);
+  r[4] = _mm512_sub_epi64(_mm512_add_epi64(a[4], _mm512_set1_epi64(0x0FFFFFFFFFFFFULL * 2)), b[4]);
+}
+
+IFMA_FN void fe8_mul(fe8 r, const fe8 a, const fe8 b) {
+  // inputs: 52bit limbs; output: 52bit limbs, limb 4 <= 2^48 (value < 2^256 + 2^48, not < P)
+  const __m512i M = _mm512_set1_epi64(FE52_M);
+  const __m512i R = _mm512_set1_epi64(FE52_R);
+  __m512i t0, t1, t2, t3, t4, t5, t6, t7, t8, t9, h;
+  t0 = t1 = t2 = t3 = t4 = t5 = t6 = t7 = t8 = t9 = h = _mm512_setzero_si512();
+
+  // 5x5 limb products: low 52 bits to column i+j, high 52 bits to column i+j+1
+  FE8_MAC(t0, t1, a[0], b[0]), FE8_MAC(t1, t2, a[0], b[1]), FE8_MAC(t2, t3, a[0], b[2]);
+  FE8_MAC(t3, t4, a[0], b[3]), FE8_MAC(t4, t5, a[0], b[4]);
+  FE8_MAC(t1, t2, a[1], b[0]), FE8_MAC(t2, t3, a[1], b[1]), FE8_MAC(t3, t4, a[1], b[2]);
+  FE8_MAC(t4, t5, a[1], b[3]), FE8_MAC(t5, t6, a[1], b[4]);
+  FE8_MAC(t2, t3, a[2], b[0]), FE8_MAC(t3, t4, a[2], b[1]), FE8_MAC(t4, t5, a[2], b[2]);
+  FE8_MAC(t5, t6, a[2], b[3]), FE8_MAC(t6, t7, a[2], b[4]);
+  FE8_MAC(t3, t4, a[3], b[0]), FE8_MAC(t4, t5, a[3], b[1]), FE8_MAC(t5, t6, a[3], b[2]);
+  FE8_MAC(t6, t7, a[3], b[3]), FE8_MAC(t7, t8, a[3], b[4]);
+  FE8_MAC(t4, t5, a[4], b[0]), FE8_MAC(t5, t6, a[4], b[1]), FE8_MAC(t6, t7, a[4], b[2]);
+  FE8_MAC(t7, t8, a[4], b[3]), FE8_MAC(t8, t9, a[4], b[4]);
+
+  // columns to 52bit, so they can be multiplied by R with IFMA again
+  FE8_CARRY(t0, t1), FE8_CARRY(t1, t2), FE8_CARRY(t2, t3), FE8_CARRY(t3, t4), FE8_CARRY(t4, t5);
+  FE8_CARRY(t5, t6), FE8_CARRY(t6, t7), FE8_CARRY(t7, t8), FE8_CARRY(t8, t9);
+
+  // 2^260 = R (mod P): fold columns 5..9 into 0..4, high part of t9 * R lands at 2^260 again
+  FE8_MAC(t0, t1, t5, R), FE8_MAC(t1, t2, t6, R), FE8_MAC(t2, t3, t7, R), FE8_MAC(t3, t4, t8, R);
+  FE8_MAC(t4, h, t9, R);
+  FE8_MAC(t0, t1, h, R);
+
+  r[0] = t0, r[1] = t1, r[2] = t2, r[3] = t3, r[4] = t4;
+  fe8_carry(r);
+  fe8_fold256(r);
+}
+
+IFMA_FN void fe8_load(fe8 r, const u64 *base, const __m512i idx) { // gather 4x64 -> 5x52
+  const __m512i M = _mm512_set1_epi64(FE52_M);
+  __m512i w0 = _mm512_i64gather_epi64(idx, base + 0, 8);
+  __m512i w1 = _mm512_i64gather_epi64(idx, base + 1, 8);
+  __m512i w2 = _mm512_i64gather_epi64(idx, base + 2, 8);
+  __m512i w3 = _mm512_i64gather_epi64(idx, base + 3, 8);
+  r[0] = _mm512_and_si512(w0, M);
+  r[1] = _mm512_and_si512(_mm512_or_si512(_mm512_srli_epi64(w0, 52), _mm512_slli_epi64(w1, 12)), M);
+  r[2] = _mm512_and_si512(_mm512_or_si512(_mm512_srli_epi64(w1, 40), _mm512_slli_epi64(w2, 24)), M);
+  r[3] = _mm512_and_si512(_mm512_or_si512(_mm512_srli_epi64(w2, 28), _mm512_slli_epi64(w3, 36)), M);
+  r[4] = _mm512_srli_epi64(w3, 16);
+}
+
+IFMA_FN void fe8_store(u64 *base, const __m512i idx, const fe8 a) { // normalized 5x52 -> 4x64
+  __m512i w0 = _mm512_or_si512(a[0], _mm512_slli_epi64(a[1], 52));
+  __m512i w1 = _mm512_or_si512(_mm512_srli_epi64(a[1], 12), _mm512_slli_epi64(a[2], 40));
+  __m512i w2 = _mm512_or_si512(_mm512_srli_epi64(a[2], 24), _mm512_slli_epi64(a[3], 28));
+  __m512i w3 = _mm512_or_si512(_mm512_srli_epi64(a[3], 36), _mm512_slli_epi64(a[4], 16));
+  _mm512_i64scatter_epi64(base + 0, idx, w0, 8);
+  _mm512_i64scatter_epi64(base + 1, idx, w1, 8);
+  _mm512_i64scatter_epi64(base + 2, idx, w2, 8);
+  _mm512_i64scatter_epi64(base + 3, idx, w3, 8);
+}
+
+IFMA_FN void fe8_set1(fe8 r, const fe a) {
+  fe52 t;
+  fe52_from_fe(t, a);
+  for (int i = 0; i < 5; ++i) r[i] = _mm512_set1_epi64(t[i]);
+}
+
+// (rx, ry)[i * step] = p + q[i] for i in 0..7, where inv[i] = 1 / (q[i].x - p.x); p, q, inv are
+// affine and reduced (eg. from group inversion), same formulas as in ec_affine_add_inv
+IFMA_TARGET void ec_affine_add_inv_x8(fe *rx, fe *ry, const int step, const pe *p, const pe *q,
+                                      const fe *inv) {
+  const __m512i lane = _mm512_set_epi64(7, 6, 5, 4, 3, 2, 1, 0);
+  const __m512i pi = _mm512_mul_epi32(lane, _mm512_set1_epi64(sizeof(pe) / sizeof(u64)));
+  const __m512i fi = _mm512_mul_epi32(lane, _mm512_set1_epi64(sizeof(fe) / sizeof(u64)));
+  const __m512i ri = _mm512_mul_epi32(lane, _mm512_set1_epi64(step * (int)(sizeof(fe) / sizeof(u64))));
+
+  fe8 x1, y1, x2, y2, l, t, d;
+  fe8_set1(x1, p->x);
+  fe8_set1(y1, p->y);
+  fe8_load(x2, q->x, pi);
+  fe8_load(y2, q->y, pi);
+  fe8_load(l, *inv, fi);
+
+  fe8_sub(t, y2, y1); // y2 - y1
+  fe8_carry(t);
+  fe8_mul(l, t, l);   // λ = (y2 - y1) / (x2 - x1)
+  fe8_mul(t, l, l);   // λ^2
+  fe8_sub(t, t, x1);  // λ^2 - x1
+  fe8_sub(t, t, x2);  // rx = λ^2 - x1 - x2
+  fe8_normalize(t);
+  fe8_sub(d, x1, t);  // x1 - rx
+  fe8_carry(d);
+  fe8_mul(d, l, d);   // λ * (x1 - rx)
+  fe8_sub(d, d, y1);  // ry = λ * (x1 - rx) - y1
+  fe8_normalize(d);
+
+  fe8_store(*rx, ri, t);
+  fe8_store(*ry, ri, d);
+}
+
+#else
+
+static bool _ec_use_ifma = false;
+INLINE void ec_affine_add_inv_x8(fe *rx, fe *ry, const int step, const pe *p, const pe *q,
+                                 const fe *inv) {
+  (void)rx, (void)ry, (void)step, (void)p, (void)q, (void)inv; // never called: no IFMA
+}
+
+#endif
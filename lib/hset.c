@@ -0,0 +1,356 @@
+// Copyright (c) vladkens
+// https://github.com/vladkens/ecloop
+// Licensed under the MIT License.
+
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "addr.c"
+#include "utils.c"
+
+#ifdef __AVX2__
+  #include <immintrin.h>
+#endif
+
+// Exact-match set for lists of hash160 (-f with text or .h160 file). Hashes are kept sorted, and
+// indexed by hash table of 64-byte buckets with 8 (tag, index) slots at half load: bucket picked by
+// the top bits of hash[0], tag is hash[1]. A miss reads one cache line (known before the lookup,
+// so it can be prefetched) and checks all 8 tags at once; the full hash is compared only on tag
+// match. No compare callbacks and no chain of dependent loads like in bsearch, and no bloom filter
+// is needed in front of it.
+
+#define HSET_WAYS 8
+
+// Small lists (puzzles) also get a bitmap on the top `bitmap_bits` bits of hash[0]: ~1024 bits per
+// hash, 32KB to 128KB, so it stays in L1/L2. Almost every key is then rejected with one load from
+// it, buckets are read only on real hits and bitmap false positives (0.1% for up to 256 hashes,
+// 1.6% at the 16K limit).
+#define HSET_BITMAP_MAX_COUNT 16384
+#define HSET_BITMAP_MIN_BITS 18
+#define HSET_BITMAP_MAX_BITS 20
+
+typedef struct hset_bucket_t {
+  u32 tag[HSET_WAYS]; // hash[1]
+  u32 idx[HSET_WAYS]; // index in hashes + 1, 0 for free slot
+} hset_bucket_t;
+
+typedef struct hset_t {
+  h160_t *hashes; // sorted, unique
+  size_t count;
+  hset_bucket_t *buckets;
+  size_t size; // number of buckets
+  hp_kind mem; // backing of buckets (see hp_alloc)
+  u32 *bitmap; // prefix bitmap for small lists, NULL otherwise
+  u32 bitmap_bits;
+  void *map;       // file mapping when loaded with hset_map, hashes and buckets point inside it
+  size_t map_size; // mapping length in bytes
+} hset_t;
+
+INLINE size_t hset_home(const hset_t *s, const h160_t h) { return (u64)h[0] * s->size >> 32; }
+
+INLINE bool hset_probe(const hset_t *s, const h160_t h, size_t b) {
+  for (;;) {
+    const hset_bucket_t *bk = &s->buckets[b];
+    u32 m = 0, full = 1;
+    for (int i = 0; i < HSET_WAYS; ++i) {
+      m |= (u32)(bk->tag[i] == h[1] && bk->idx[i] != 0) << i;
+      full &= bk->idx[i] != 0;
+    }
+
+    for (; m != 0; m &= m - 1) {
+      const u32 *x = s->hashes[bk->idx[__builtin_ctz(m)] - 1];
+      if (((x[0] ^ h[0]) | (x[2] ^ h[2]) | (x[3] ^ h[3]) | (x[4] ^ h[4])) == 0) return true;
+    }
+
+    if (!full) return false; // hash would be in this bucket, next ones are overflow only
+    b = b + 1 == s->size ? 0 : b + 1;
+  }
+}
+
+INLINE bool hset_bitmap_has(const hset_t *s, const h160_t h) {
+  u32 p = h[0] >> (32 - s->bitmap_bits);
+  return s->bitmap[p / 32] >> (p % 32) & 1;
+}
+
+// bit i is set when hashes[i] is in the bitmap
+INLINE u32 hset_bitmap_has8(const hset_t *s, const h160_t *hashes) {
+#ifdef __AVX2__
+  const __m256i offs = _mm256_setr_epi32(0, 5, 10, 15, 20, 25, 30, 35); // hash[0] of each h160_t
+  __m256i h0 = _mm256_i32gather_epi32((const int *)hashes, offs, 4);
+  __m256i p = _mm256_srl_epi32(h0, _mm_cvtsi32_si128(32 - s->bitmap_bits));
+  __m256i w = _mm256_i32gather_epi32((const int *)s->bitmap, _mm256_srli_epi32(p, 5), 4);
+  w = _mm256_srlv_epi32(w, _mm256_and_si256(p, _mm256_set1_epi32(31)));
+  w = _mm256_slli_epi32(w, 31); // bit to sign for movemask
+  return (u32)_mm256_movemask_ps(_mm256_castsi256_ps(w));
+#else
+  u32 m = 0;
+  for (int i = 0; i < 8; ++i) m |= (u32)hset_bitmap_has(s, hashes[i]) << i;
+  return m;
+#endif
+}
+
+bool hset_has(const hset_t *s, const h160_t h) {
+  if (s->bitmap != NULL && !hset_bitmap_has(s, h)) return false;
+  return hset_probe(s, h, hset_home(s, h));
+}
+
+// same interface as blf_has8; home buckets of all 8 hashes are computed before any probing
+void hset_has8(uint8_t out[8], const hset_t *s, const h160_t *hashes) {
+  if (s->bitmap != NULL) {
+    u32 m = hset_bitmap_has8(s, hashes);
+    memset(out, 0, 8);
+    for (; m != 0; m &= m - 1) {
+      int i = __builtin_ctz(m);
+      out[i] = hset_probe(s, hashes[i], hset_home(s, hashes[i]));
+    }
+    return;
+  }
+
+  size_t b[8];
+  for (int i = 0; i < 8; ++i) b[i] = hset_home(s, hashes[i]);
+  for (int i = 0; i < 8; ++i) out[i] = hset_probe(s, hashes[i], b[i]);
+}
+
+INLINE void hset_prefetch(const hset_t *s, const h160_t h) {
+  if (s->bitmap != NULL) return; // bitmap is in cache, buckets are rarely read
+  __builtin_prefetch(&s->buckets[hset_home(s, h)]);
+}
+
+void _hset_index(hset_t *s) {
+  s->size = MAX(1ul, s->count * 2 / HSET_WAYS);
+  s->buckets = hp_alloc(s->size * sizeof(hset_bucket_t), &s->mem); // zeroed, 64-byte aligned
+  if (s->buckets == NULL) {
+    fprintf(stderr, "failed to allocate hash list index\n");
+    exit(1);
+  }
+
+  for (size_t i = 0; i < s->count; ++i) {
+    for (size_t b = hset_home(s, s->hashes[i]);; b = b + 1 == s->size ? 0 : b + 1) {
+      hset_bucket_t *bk = &s->buckets[b];
+      int k = 0;
+      while (k < HSET_WAYS && bk->idx[k] != 0) k += 1;
+      if (k == HSET_WAYS) continue;
+
+      bk->tag[k] = s->hashes[i][1];
+      bk->idx[k] = (u32)i + 1;
+      break;
+    }
+  }
+}
+
+void _hset_bitmap(hset_t *s) {
+  if (s->count > HSET_BITMAP_MAX_COUNT) return;
+
+  u32 bits = HSET_BITMAP_MIN_BITS;
+  while (bits < HSET_BITMAP_MAX_BITS && ((size_t)1 << bits) < s->count * 1024) bits += 1;
+
+  s->bitmap_bits = bits;
+  s->bitmap = calloc(((size_t)1 << bits) / 32, sizeof(u32));
+  if (s->bitmap == NULL) {
+    fprintf(stderr, "failed to allocate hash list bitmap\n");
+    exit(1);
+  }
+
+  for (size_t i = 0; i < s->count; ++i) {
+    u32 p = s->hashes[i][0] >> (32 - bits);
+    s->bitmap[p / 32] |= 1u << (p % 32);
+  }
+}
+
+// takes ownership of `hashes` (malloc'ed), sorts them and drops duplicates
+void hset_init(hset_t *s, h160_t *hashes, size_t count) {
+  if (count >= UINT32_MAX / 2) {
+    fprintf(stderr, "too many hashes in list (%'zu)\n", count);
+    exit(1);
+  }
+
+  qsort(hashes, count, sizeof(h160_t), compare_160);
+
+  size_t unique_count = 0;
+  for (size_t i = 0; i < count; ++i) {
+    if (unique_count > 0 && memcmp(hashes[unique_count - 1], hashes[i], sizeof(h160_t)) == 0) {
+      continue;
+    }
+    if (unique_count != i) memcpy(hashes[unique_count], hashes[i], sizeof(h160_t));
+    unique_count += 1;
+  }
+
+  s->hashes = hashes;
+  s->count = unique_count;
+  _hset_index(s);
+  _hset_bitmap(s);
+}
+
+void hset_free(hset_t *s) {
+#ifndef _WIN32
+  if (s->map != NULL) munmap(s->map, s->map_size);
+#endif
+  if (s->map == NULL) free(s->hashes);
+  if (s->map == NULL) hp_free(s->buckets, s->size * sizeof(hset_bucket_t), s->mem);
+  free(s->bitmap);
+  *s = (hset_t){0};
+}
+
+// MARK: .h160 file
+
+// Sorted hashes and their bucket index as is, so loading needs no parsing, sorting or indexing
+// and the file can be mapped (and shared by processes). Layout: 64-byte header, hashes (20 bytes
+// each), buckets (64 bytes each, from next 64-byte aligned offset).
+
+#define HSET_MAGIC 0x45434853 // FourCC: ECHS
+#define HSET_VERSION 1
+
+typedef struct hset_head_t {
+  u32 magic;
+  u32 version;
+  u64 count; // hashes
+  u64 size;  // buckets
+  u8 pad[40];
+} hset_head_t;
+
+static_assert(sizeof(hset_head_t) == 64, "hset_head_t must be 64 bytes");
+static_assert(sizeof(hset_bucket_t) == 64, "hset_bucket_t must be 64 bytes");
+
+INLINE size_t hset_buckets_offset(u64 count) {
+  return (sizeof(hset_head_t) + count * sizeof(h160_t) + 63) / 64 * 64;
+}
+
+// total file size for valid header, 0 otherwise
+size_t hset_check_head(const hset_head_t *head) {
+  bool is_ok = head->magic == HSET_MAGIC && head->version == HSET_VERSION;
+  is_ok = is_ok && head->count < UINT32_MAX / 2;
+  is_ok = is_ok && head->size == MAX(1ul, head->count * 2 / HSET_WAYS);
+  if (!is_ok) {
+    fprintf(stderr, "invalid hash list file; create a new one with h160-gen command\n");
+    return 0;
+  }
+
+  return hset_buckets_offset(head->count) + head->size * sizeof(hset_bucket_t);
+}
+
+bool hset_save(const char *filepath, const hset_t *s) {
+  FILE *file = file_create(filepath, "wb"); // see file_replace
+  if (file == NULL) {
+    fprintf(stderr, "failed to open output file\n");
+    return false;
+  }
+
+  hset_head_t head = {.magic = HSET_MAGIC, .version = HSET_VERSION};
+  head.count = s->count;
+  head.size = s->size;
+
+  u8 pad[64] = {0};
+  size_t pad_size = hset_buckets_offset(s->count) - sizeof(head) - s->count * sizeof(h160_t);
+
+  bool is_ok = true;
+  is_ok = is_ok && fwrite(&head, sizeof(head), 1, file) == 1;
+  is_ok = is_ok && fwrite(s->hashes, sizeof(h160_t), s->count, file) == s->count;
+  is_ok = is_ok && fwrite(pad, 1, pad_size, file) == pad_size;
+  is_ok = is_ok && fwrite(s->buckets, sizeof(hset_bucket_t), s->size, file) == s->size;
+  is_ok = file_replace(file, filepath, is_ok);
+  if (!is_ok) fprintf(stderr, "failed to write hash list\n");
+  return is_ok;
+}
+
+// reads file into private memory (buckets can be on huge pages, see hp_alloc)
+bool hset_load(const char *filepath, hset_t *s) {
+  FILE *file = fopen(filepath, "rb");
+  if (file == NULL) {
+    fprintf(stderr, "failed to open input file\n");
+    return false;
+  }
+
+  hset_head_t head;
+  if (fread(&head, sizeof(head), 1, file) != 1 || hset_check_head(&head) == 0) {
+    fclose(file);
+    return false;
+  }
+
+  s->count = head.count;
+  s->size = head.size;
+  s->hashes = malloc(MAX(1ul, s->count) * sizeof(h160_t));
+  s->buckets = hp_alloc(s->size * sizeof(hset_bucket_t), &s->mem);
+  if (s->hashes == NULL || s->buckets == NULL) {
+    fprintf(stderr, "failed to allocate hash list\n");
+    exit(1);
+  }
+
+  bool is_ok = fread(s->hashes, sizeof(h160_t), s->count, file) == s->count;
+  is_ok = is_ok && fseek(file, hset_buckets_offset(s->count), SEEK_SET) == 0;
+  is_ok = is_ok && fread(s->buckets, sizeof(hset_bucket_t), s->size, file) == s->size;
+  fclose(file);
+  if (!is_ok) {
+    fprintf(stderr, "failed to read hash list\n");
+    return false;
+  }
+
+  _hset_bitmap(s);
+  return true;
+}
+
+// maps file read-only, see blf_map
+bool hset_map(const char *filepath, hset_t *s, bool populate) {
+#ifdef _WIN32
+  (void)populate;
+  return hset_load(filepath, s);
+#else
+  size_t map_size;
+  u8 *map = file_map(filepath, sizeof(hset_head_t), populate, &map_size);
+  if (map == NULL) return false;
+
+  hset_head_t head;
+  memcpy(&head, map, sizeof(head));
+
+  size_t file_size = hset_check_head(&head);
+  if (file_size == 0 || map_size != file_size) {
+    if (file_size != 0) fprintf(stderr, "hash list file is truncated\n");
+    munmap(map, map_size);
+    return false;
+  }
+
+  s->count = head.count;
+  s->size = head.size;
+  s->hashes = (h160_t *)(map + sizeof(head));
+  s->buckets = (hset_bucket_t *)(map + hset_buckets_offset(head.count));
+  s->map = map;
+  s->map_size = map_size;
+  _hset_bitmap(s);
+  return true;
+#endif
+}
+
+// MARK: h160-gen command
+
+void __h160_gen_usage(args_t *args) {
+  printf("Usage: %s h160-gen -o <file>\n", args->argv[0]);
+  printf("Convert a list of hex-encoded hash160 values passed to stdin to .h160 file.\n");
+  printf("\nOptions:\n");
+  printf("  -o <file>       - File to write hash list (must have a .h160 extension).\n");
+  printf("  -bin            - Read binary 20-byte hash160 records instead of hex lines.\n");
+  exit(1);
+}
+
+void h160_gen(args_t *args) {
+  char *filepath = arg_str(args, "-o");
+  if (filepath == NULL) {
+    fprintf(stderr, "[!] missing output file (-o <file>)\n");
+    return __h160_gen_usage(args);
+  }
+
+  size_t count;
+  h160_t *hashes = h160_read_all(stdin, args_bool(args, "-bin"), &count);
+
+  hset_t s = {0};
+  hset_init(&s, hashes, count);
+  printf("read %'zu hashes, %'zu unique; saving to %s\n", count, s.count, filepath);
+
+  if (!hset_save(filepath, &s)) {
+    fprintf(stderr, "[!] failed to save hash list\n");
+    exit(1);
+  }
+
+  hset_free(&s);
+}
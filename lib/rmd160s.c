@@ -43,6 +43,42 @@
   #define RMD_ADD3(a, b, c) vaddq_u32(vaddq_u32(a, b), c)
   #define RMD_ADD4(a, b, c, d) vaddq_u32(vaddq_u32(vaddq_u32(a, b), c), d)
 
+#elif defined(__x86_64__) && defined(__AVX512F__) && defined(__AVX512BW__) && !defined(NO_SIMD)
+  #include <immintrin.h>
+
+  #define RMD_LEN 16
+  #define RMD_VEC __m512i
+  #define RMD_LD_NUM(x) _mm512_set1_epi32(x)
+
+  #define RMD_SWAP(x)                                                                              \
+    _mm512_shuffle_epi8((x), _mm512_set4_epi32(0x0c0d0e0f, 0x08090a0b, 0x04050607, 0x00010203))
+
+  // word i of every row (works for any row length, stride taken from the array type)
+  #define RMD_LOAD(x, i)                                                                           \
+    _mm512_i32gather_epi32(                                                                        \
+        _mm512_mullo_epi32(_mm512_set_epi32(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0), \
+                           _mm512_set1_epi32(sizeof(x[0]) / sizeof(x[0][0]))),                     \
+        (const int *)&x[0][i], 4)
+
+  #define RMD_DUMP(r, s, i)                                                                        \
+    do {                                                                                           \
+      alignas(64) int32_t tmp[16];                                                                 \
+      _mm512_store_si512((__m512i *)tmp, s[i]);                                                    \
+      for (int j = 0; j < 16; ++j) r[j][i] = tmp[j];                                               \
+    } while (0);
+
+  // boolean functions as vpternlogd truth tables (x = 0xF0, y = 0xCC, z = 0xAA)
+  #define RMD_F1(x, y, z) _mm512_ternarylogic_epi32(x, y, z, 0x96)
+  #define RMD_F2(x, y, z) _mm512_ternarylogic_epi32(x, y, z, 0xCA)
+  #define RMD_F3(x, y, z) _mm512_ternarylogic_epi32(x, y, z, 0x59)
+  #define RMD_F4(x, y, z) _mm512_ternarylogic_epi32(x, y, z, 0xE4)
+  #define RMD_F5(x, y, z) _mm512_ternarylogic_epi32(x, y, z, 0x2D)
+
+  #define RMD_ROTL(x, n) _mm512_rol_epi32(x, n)
+  #define RMD_ADD2(a, b) _mm512_add_epi32(a, b)
+  #define RMD_ADD3(a, b, c) _mm512_add_epi32(_mm512_add_epi32(a, b), c)
+  #define RMD_ADD4(a, b, c, d) _mm512_add_epi32(_mm512_add_epi32(a, b), _mm512_add_epi32(c, d))
+
 #elif defined(__x86_64__) && defined(__AVX2__) && !defined(NO_SIMD)
   #include <immintrin.h>
 
@@ -58,6 +94,27 @@
   #define RMD_LOAD(x, i)                                                                           \
     _mm256_set_epi32(x[7][i], x[6][i], x[5][i], x[4][i], x[3][i], x[2][i], x[1][i], x[0][i])
 
+  // 8x8 transpose: x[j][i] (row per lane) -> w[i] (word i of every lane)
+  #define RMD_LOAD_ROWS(w, x)                                                                      \
+    do {                                                                                           \
+      __m256i r[8], t[8];                                                                          \
+      for (int j = 0; j < 8; ++j) r[j] = _mm256_loadu_si256((const __m256i *)x[j]);               \
+      for (int j = 0; j < 8; j += 2) {                                                             \
+        t[j + 0] = _mm256_unpacklo_epi32(r[j], r[j + 1]);                                          \
+        t[j + 1] = _mm256_unpackhi_epi32(r[j], r[j + 1]);                                          \
+      }                                                                                            \
+      for (int j = 0; j < 8; j += 4) {                                                             \
+        r[j + 0] = _mm256_unpacklo_epi64(t[j + 0], t[j + 2]);                                      \
+        r[j + 1] = _mm256_unpackhi_epi64(t[j + 0], t[j + 2]);                                      \
+        r[j + 2] = _mm256_unpacklo_epi64(t[j + 1], t[j + 3]);                                      \
+        r[j + 3] = _mm256_unpackhi_epi64(t[j + 1], t[j + 3]);                                      \
+      }                                                                                            \
+      for (int j = 0; j < 4; ++j) {                                                                \
+        w[j + 0] = _mm256_permute2x128_si256(r[j], r[j + 4], 0x20);                                \
+        w[j + 4] = _mm256_permute2x128_si256(r[j], r[j + 4], 0x31);                                \
+      }                                                                                            \
+    } while (0)
+
   #define RMD_DUMP(r, s, i)                                                                        \
     do {                                                                                           \
       alignas(32) int32_t tmp[8];                                                                  \
@@ -119,7 +176,13 @@
 
 #define RMD_LOAD_SWAP(x, i) RMD_SWAP(RMD_LOAD(x, i))
 
-void rmd160_block(RMD_VEC *s, const uint32_t x[RMD_LEN][16]) {
+#ifndef RMD_LOAD_ROWS
+  #define RMD_LOAD_ROWS(w, x)                                                                      \
+    for (int i = 0; i < 8; ++i) w[i] = RMD_LOAD(x, i)
+#endif
+
+// message already in registers (w[i] holds word i of every lane, little-endian)
+void rmd160_block_w(RMD_VEC *s, const RMD_VEC w[16]) {
   RMD_VEC a1, b1, c1, d1, e1, a2, b2, c2, d2, e2, u;
   a1 = a2 = RMD_LD_NUM(RMD_K1);
   b1 = b2 = RMD_LD_NUM(RMD_K2);
@@ -127,28 +190,6 @@ void rmd160_block(RMD_VEC *s, const uint32_t x[RMD_LEN][16]) {
   d1 = d2 = RMD_LD_NUM(RMD_K4);
   e1 = e2 = RMD_LD_NUM(RMD_K5);
 
-  RMD_VEC w[16];
-  // for (int i = 0; i < 16; i++) w[i] = RMD_LOAD(x, i);
-
-  // SHA256 is big-endian, but RIPEMD-160 is little-endian, so swap bytes here
-  // keep unrolled let ILP decide how to schedule
-  w[0] = RMD_LOAD_SWAP(x, 0);
-  w[1] = RMD_LOAD_SWAP(x, 1);
-  w[2] = RMD_LOAD_SWAP(x, 2);
-  w[3] = RMD_LOAD_SWAP(x, 3);
-  w[4] = RMD_LOAD_SWAP(x, 4);
-  w[5] = RMD_LOAD_SWAP(x, 5);
-  w[6] = RMD_LOAD_SWAP(x, 6);
-  w[7] = RMD_LOAD_SWAP(x, 7);
-  w[8] = RMD_LOAD_SWAP(x, 8);
-  w[9] = RMD_LOAD_SWAP(x, 9);
-  w[10] = RMD_LOAD_SWAP(x, 10);
-  w[11] = RMD_LOAD_SWAP(x, 11);
-  w[12] = RMD_LOAD_SWAP(x, 12);
-  w[13] = RMD_LOAD_SWAP(x, 13);
-  w[14] = RMD_LOAD_SWAP(x, 14);
-  w[15] = RMD_LOAD_SWAP(x, 15);
-
   RMD_L1(a1, b1, c1, d1, e1, w[0], 11);
   RMD_R1(a2, b2, c2, d2, e2, w[5], 8);
   RMD_L1(e1, a1, b1, c1, d1, w[1], 14);
@@ -322,6 +363,45 @@ void rmd160_block(RMD_VEC *s, const uint32_t x[RMD_LEN][16]) {
   s[4] = RMD_ADD3(t, b1, c2);
 }
 
+void rmd160_block(RMD_VEC *s, const uint32_t x[RMD_LEN][16]) {
+  RMD_VEC w[16];
+  // for (int i = 0; i < 16; i++) w[i] = RMD_LOAD(x, i);
+
+  // SHA256 is big-endian, but RIPEMD-160 is little-endian, so swap bytes here
+  // keep unrolled let ILP decide how to schedule
+  w[0] = RMD_LOAD_SWAP(x, 0);
+  w[1] = RMD_LOAD_SWAP(x, 1);
+  w[2] = RMD_LOAD_SWAP(x, 2);
+  w[3] = RMD_LOAD_SWAP(x, 3);
+  w[4] = RMD_LOAD_SWAP(x, 4);
+  w[5] = RMD_LOAD_SWAP(x, 5);
+  w[6] = RMD_LOAD_SWAP(x, 6);
+  w[7] = RMD_LOAD_SWAP(x, 7);
+  w[8] = RMD_LOAD_SWAP(x, 8);
+  w[9] = RMD_LOAD_SWAP(x, 9);
+  w[10] = RMD_LOAD_SWAP(x, 10);
+  w[11] = RMD_LOAD_SWAP(x, 11);
+  w[12] = RMD_LOAD_SWAP(x, 12);
+  w[13] = RMD_LOAD_SWAP(x, 13);
+  w[14] = RMD_LOAD_SWAP(x, 14);
+  w[15] = RMD_LOAD_SWAP(x, 15);
+
+  rmd160_block_w(s, w);
+}
+
+void rmd160_batch_w(uint32_t r[RMD_LEN][5], const RMD_VEC w[16]) {
+  RMD_VEC s[5] = {0}; // load initial state
+  s[0] = RMD_LD_NUM(RMD_K1);
+  s[1] = RMD_LD_NUM(RMD_K2);
+  s[2] = RMD_LD_NUM(RMD_K3);
+  s[3] = RMD_LD_NUM(RMD_K4);
+  s[4] = RMD_LD_NUM(RMD_K5);
+
+  rmd160_block_w((RMD_VEC *)s, w);                   // round
+  for (int i = 0; i < 5; ++i) s[i] = RMD_SWAP(s[i]); // change endian
+  for (int i = 0; i < 5; ++i) RMD_DUMP(r, s, i);     // dump data to array
+}
+
 void rmd160_batch(uint32_t r[RMD_LEN][5], const uint32_t x[RMD_LEN][16]) {
   RMD_VEC s[5] = {0}; // load initial state
   s[0] = RMD_LD_NUM(RMD_K1);
@@ -384,6 +384,76 @@ void sha256_final(u32 state[8], const u8 data[], u32 length) {
   _mm_storeu_si128((__m128i *)&state[4], STATE1);
 }
 
+// Interleaved SHA-NI: N messages of same length hashed together. sha256rnds2 has multi-cycle
+// latency and each stream is one long dependency chain, so independent streams fill the gaps.
+// Same rounds as sha256_final, message schedule written as a ring of 4 registers.
+INLINE void _sha256_final_xn(u32 *state[], const u8 *data[], u32 length, const int n) {
+  const __m128i MASK = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+  __m128i STATE0[4], STATE1[4], ABEF_SAVE[4], CDGH_SAVE[4], MSG[4][4], T[4]; // n <= 4
+
+  for (int j = 0; j < n; ++j) {
+    T[j] = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&SHA256_IV[0]), 0xB1); /* CDAB */
+    STATE1[j] = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&SHA256_IV[4]), 0x1B);
+    STATE0[j] = _mm_alignr_epi8(T[j], STATE1[j], 8);    /* ABEF */
+    STATE1[j] = _mm_blend_epi16(STATE1[j], T[j], 0xF0); /* CDGH */
+  }
+
+  for (u32 offset = 0; offset < length; offset += 64) {
+    for (int j = 0; j < n; ++j) ABEF_SAVE[j] = STATE0[j], CDGH_SAVE[j] = STATE1[j];
+
+    // fully unrolled, so MSG indices are constant and everything stays in registers
+    #pragma GCC unroll 16
+    for (int q = 0; q < 16; ++q) { // 4 rounds per step
+      const __m128i K = _mm_loadu_si128((const __m128i *)&SHA256_K[q * 4]);
+      #pragma GCC unroll 4
+      for (int j = 0; j < n; ++j) {
+        if (q < 4) {
+          MSG[j][q] = _mm_loadu_si128((const __m128i *)(data[j] + offset + q * 16));
+          MSG[j][q] = _mm_shuffle_epi8(MSG[j][q], MASK);
+        }
+
+        T[j] = _mm_add_epi32(MSG[j][q & 3], K);
+        STATE1[j] = _mm_sha256rnds2_epu32(STATE1[j], STATE0[j], T[j]);
+
+        if (q >= 3 && q <= 14) {
+          __m128i TMP = _mm_alignr_epi8(MSG[j][q & 3], MSG[j][(q - 1) & 3], 4);
+          MSG[j][(q + 1) & 3] = _mm_add_epi32(MSG[j][(q + 1) & 3], TMP);
+          MSG[j][(q + 1) & 3] = _mm_sha256msg2_epu32(MSG[j][(q + 1) & 3], MSG[j][q & 3]);
+        }
+
+        T[j] = _mm_shuffle_epi32(T[j], 0x0E);
+        STATE0[j] = _mm_sha256rnds2_epu32(STATE0[j], STATE1[j], T[j]);
+
+        if (q >= 1 && q <= 12) {
+          MSG[j][(q - 1) & 3] = _mm_sha256msg1_epu32(MSG[j][(q - 1) & 3], MSG[j][q & 3]);
+        }
+      }
+    }
+
+    for (int j = 0; j < n; ++j) {
+      STATE0[j] = _mm_add_epi32(STATE0[j], ABEF_SAVE[j]);
+      STATE1[j] = _mm_add_epi32(STATE1[j], CDGH_SAVE[j]);
+    }
+  }
+
+  for (int j = 0; j < n; ++j) {
+    T[j] = _mm_shuffle_epi32(STATE0[j], 0x1B);          /* FEBA */
+    STATE1[j] = _mm_shuffle_epi32(STATE1[j], 0xB1);     /* DCHG */
+    STATE0[j] = _mm_blend_epi16(T[j], STATE1[j], 0xF0); /* DCBA */
+    STATE1[j] = _mm_alignr_epi8(STATE1[j], T[j], 8);    /* ABEF */
+    _mm_storeu_si128((__m128i *)&state[j][0], STATE0[j]);
+    _mm_storeu_si128((__m128i *)&state[j][4], STATE1[j]);
+  }
+}
+
+void sha256_final_x2(u32 *state[2], const u8 *data[2], u32 length) {
+  _sha256_final_xn(state, data, length, 2);
+}
+
+void sha256_final_x4(u32 *state[4], const u8 *data[4], u32 length) {
+  _sha256_final_xn(state, data, length, 4);
+}
+
 #else
 // #warning "SHA256: no intrinsics available, using fallback implementation"
 
@@ -0,0 +1,234 @@
+// Copyright (c) vladkens
+// https://github.com/vladkens/ecloop
+// Licensed under the MIT License.
+
+#pragma once
+#include <stdint.h>
+
+#include "sha256.c"
+
+// Multi-buffer SHA-256: SHA_LEN independent messages hashed at once, one message per
+// vector lane. Used on CPUs without SHA extensions, where scalar SHA-256 is the main
+// hashing cost. State stays in registers (transposed: s[i] holds word i of every lane).
+
+#if defined(__x86_64__) && defined(__AVX512F__) && defined(__AVX512BW__) && !defined(NO_SIMD)
+  #include <immintrin.h>
+
+  #define SHA_LEN 16
+  #define SHA_VEC __m512i
+  #define SHA_LD_NUM(x) _mm512_set1_epi32(x)
+
+  #define SHA_SWAP(x)                                                                              \
+    _mm512_shuffle_epi8((x), _mm512_set4_epi32(0x0c0d0e0f, 0x08090a0b, 0x04050607, 0x00010203))
+
+  // word i of every message (messages are `size` bytes apart)
+  #define SHA_LOAD(msg, size, i)                                                                   \
+    _mm512_i32gather_epi32(_mm512_mullo_epi32(_mm512_set_epi32(15, 14, 13, 12, 11, 10, 9, 8, 7,  \
+                                                                6, 5, 4, 3, 2, 1, 0),              \
+                                              _mm512_set1_epi32(size)),                            \
+                           (const int *)(msg) + (i), 1)
+
+  #define SHA_ADD2(a, b) _mm512_add_epi32(a, b)
+  #define SHA_ROTR(x, n) _mm512_ror_epi32(x, n)
+  #define SHA_SHR(x, n) _mm512_srli_epi32(x, n)
+  #define SHA_XOR3(a, b, c) _mm512_ternarylogic_epi32(a, b, c, 0x96)
+  #define SHA_CH(e, f, g) _mm512_ternarylogic_epi32(e, f, g, 0xCA)
+  #define SHA_MAJ(a, b, c) _mm512_ternarylogic_epi32(a, b, c, 0xE8)
+
+#elif defined(__x86_64__) && defined(__AVX2__) && !defined(NO_SIMD)
+  #include <immintrin.h>
+
+  #define SHA_LEN 8
+  #define SHA_VEC __m256i
+  #define SHA_LD_NUM(x) _mm256_set1_epi32(x)
+
+  #define SHA_SWAP(x)                                                                              \
+    _mm256_shuffle_epi8((x), _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13,    \
+                                              12, 19, 18, 17, 16, 23, 22, 21, 20, 27, 26, 25, 24,  \
+                                              31, 30, 29, 28))
+
+  #define SHA_LOAD(msg, size, i)                                                                   \
+    _mm256_i32gather_epi32((const int *)(msg) + (i),                                               \
+                           _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),           \
+                                              _mm256_set1_epi32(size)),                            \
+                           1)
+
+  #define SHA_ADD2(a, b) _mm256_add_epi32(a, b)
+  #define SHA_ROTR(x, n) _mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32 - (n)))
+  #define SHA_SHR(x, n) _mm256_srli_epi32(x, n)
+  #define SHA_XOR3(a, b, c) _mm256_xor_si256(_mm256_xor_si256(a, b), c)
+  #define SHA_CH(e, f, g) _mm256_xor_si256(_mm256_and_si256(e, _mm256_xor_si256(f, g)), g)
+  #define SHA_MAJ(a, b, c)                                                                         \
+    _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(c, _mm256_or_si256(a, b)))
+
+#endif
+
+#ifdef SHA_LEN
+
+  #define SHA_ADD3(a, b, c) SHA_ADD2(SHA_ADD2(a, b), c)
+  #define SHA_ADD4(a, b, c, d) SHA_ADD2(SHA_ADD2(a, b), SHA_ADD2(c, d))
+
+  #define SHA_S0(x) SHA_XOR3(SHA_ROTR(x, 2), SHA_ROTR(x, 13), SHA_ROTR(x, 22))
+  #define SHA_S1(x) SHA_XOR3(SHA_ROTR(x, 6), SHA_ROTR(x, 11), SHA_ROTR(x, 25))
+  #define SHA_G0(x) SHA_XOR3(SHA_ROTR(x, 7), SHA_ROTR(x, 18), SHA_SHR(x, 3))
+  #define SHA_G1(x) SHA_XOR3(SHA_ROTR(x, 17), SHA_ROTR(x, 19), SHA_SHR(x, 10))
+
+  // registers are not moved between rounds, instead caller rotates arguments
+  #define SHA_RK(a, b, c, d, e, f, g, h, kw)                                                       \
+    t = SHA_ADD4(h, SHA_S1(e), SHA_CH(e, f, g), kw);                                               \
+    d = SHA_ADD2(d, t);                                                                            \
+    h = SHA_ADD3(t, SHA_S0(a), SHA_MAJ(a, b, c));
+
+  #define SHA_RN(a, b, c, d, e, f, g, h, w, k)                                                     \
+    SHA_RK(a, b, c, d, e, f, g, h, SHA_ADD2(w, SHA_LD_NUM(k)))
+
+  // message schedule in 16-word ring: w[i] += g1(w[i-2]) + w[i-7] + g0(w[i-15])
+  #define SHA_WN(w, i)                                                                             \
+    w[(i) & 15] = SHA_ADD4(w[(i) & 15], SHA_G1(w[((i) - 2) & 15]), w[((i) - 7) & 15],             \
+                           SHA_G0(w[((i) - 15) & 15]));
+
+void sha256_block_x(SHA_VEC s[8], SHA_VEC w[16]) {
+  SHA_VEC a = s[0], b = s[1], c = s[2], d = s[3], e = s[4], f = s[5], g = s[6], h = s[7], t;
+
+  for (int i = 0; i < 64; i += 8) {
+    if (i >= 16) {
+      SHA_WN(w, i + 0);
+      SHA_WN(w, i + 1);
+      SHA_WN(w, i + 2);
+      SHA_WN(w, i + 3);
+      SHA_WN(w, i + 4);
+      SHA_WN(w, i + 5);
+      SHA_WN(w, i + 6);
+      SHA_WN(w, i + 7);
+    }
+
+    SHA_RN(a, b, c, d, e, f, g, h, w[(i + 0) & 15], SHA256_K[i + 0]);
+    SHA_RN(h, a, b, c, d, e, f, g, w[(i + 1) & 15], SHA256_K[i + 1]);
+    SHA_RN(g, h, a, b, c, d, e, f, w[(i + 2) & 15], SHA256_K[i + 2]);
+    SHA_RN(f, g, h, a, b, c, d, e, w[(i + 3) & 15], SHA256_K[i + 3]);
+    SHA_RN(e, f, g, h, a, b, c, d, w[(i + 4) & 15], SHA256_K[i + 4]);
+    SHA_RN(d, e, f, g, h, a, b, c, w[(i + 5) & 15], SHA256_K[i + 5]);
+    SHA_RN(c, d, e, f, g, h, a, b, w[(i + 6) & 15], SHA256_K[i + 6]);
+    SHA_RN(b, c, d, e, f, g, h, a, w[(i + 7) & 15], SHA256_K[i + 7]);
+  }
+
+  s[0] = SHA_ADD2(s[0], a);
+  s[1] = SHA_ADD2(s[1], b);
+  s[2] = SHA_ADD2(s[2], c);
+  s[3] = SHA_ADD2(s[3], d);
+  s[4] = SHA_ADD2(s[4], e);
+  s[5] = SHA_ADD2(s[5], f);
+  s[6] = SHA_ADD2(s[6], g);
+  s[7] = SHA_ADD2(s[7], h);
+}
+
+// scalar sigma functions, only used to fold constants of the schedule below
+INLINE u32 _sha256_g0(u32 x) {
+  return ((x >> 7) | (x << 25)) ^ ((x >> 18) | (x << 14)) ^ (x >> 3);
+}
+
+INLINE u32 _sha256_g1(u32 x) {
+  return ((x >> 17) | (x << 15)) ^ ((x >> 19) | (x << 13)) ^ (x >> 10);
+}
+
+// Second block of a 65-byte message (uncompressed pubkey): word 0 is the last byte of y with
+// the 0x80 pad, words 1..14 are zero and word 15 is the bit length. So rounds 1..15 take K+W
+// as constants and the schedule up to w31 is written out with the zero terms dropped.
+void sha256_block_x65(SHA_VEC s[8], const SHA_VEC x) {
+  SHA_VEC a = s[0], b = s[1], c = s[2], d = s[3], e = s[4], f = s[5], g = s[6], h = s[7], t;
+  const u32 L = 65 * 8;
+  const u32 w17 = _sha256_g1(L), w19 = _sha256_g1(w17), w21 = _sha256_g1(w19);
+
+  SHA_RN(a, b, c, d, e, f, g, h, x, SHA256_K[0]);
+  SHA_RK(h, a, b, c, d, e, f, g, SHA_LD_NUM(SHA256_K[1]));
+  SHA_RK(g, h, a, b, c, d, e, f, SHA_LD_NUM(SHA256_K[2]));
+  SHA_RK(f, g, h, a, b, c, d, e, SHA_LD_NUM(SHA256_K[3]));
+  SHA_RK(e, f, g, h, a, b, c, d, SHA_LD_NUM(SHA256_K[4]));
+  SHA_RK(d, e, f, g, h, a, b, c, SHA_LD_NUM(SHA256_K[5]));
+  SHA_RK(c, d, e, f, g, h, a, b, SHA_LD_NUM(SHA256_K[6]));
+  SHA_RK(b, c, d, e, f, g, h, a, SHA_LD_NUM(SHA256_K[7]));
+  SHA_RK(a, b, c, d, e, f, g, h, SHA_LD_NUM(SHA256_K[8]));
+  SHA_RK(h, a, b, c, d, e, f, g, SHA_LD_NUM(SHA256_K[9]));
+  SHA_RK(g, h, a, b, c, d, e, f, SHA_LD_NUM(SHA256_K[10]));
+  SHA_RK(f, g, h, a, b, c, d, e, SHA_LD_NUM(SHA256_K[11]));
+  SHA_RK(e, f, g, h, a, b, c, d, SHA_LD_NUM(SHA256_K[12]));
+  SHA_RK(d, e, f, g, h, a, b, c, SHA_LD_NUM(SHA256_K[13]));
+  SHA_RK(c, d, e, f, g, h, a, b, SHA_LD_NUM(SHA256_K[14]));
+  SHA_RK(b, c, d, e, f, g, h, a, SHA_LD_NUM(SHA256_K[15] + L));
+
+  // w[i] holds w(16 + i), same ring layout as in sha256_block_x
+  SHA_VEC w[16];
+  w[0] = x;
+  w[1] = SHA_LD_NUM(w17);
+  w[2] = SHA_G1(x);
+  w[3] = SHA_LD_NUM(w19);
+  w[4] = SHA_G1(w[2]);
+  w[5] = SHA_LD_NUM(w21);
+  w[6] = SHA_ADD2(SHA_G1(w[4]), SHA_LD_NUM(L));
+  w[7] = SHA_ADD2(x, SHA_LD_NUM(_sha256_g1(w21)));
+  w[8] = SHA_ADD2(SHA_G1(w[6]), w[1]);
+  w[9] = SHA_ADD2(SHA_G1(w[7]), w[2]);
+  w[10] = SHA_ADD2(SHA_G1(w[8]), w[3]);
+  w[11] = SHA_ADD2(SHA_G1(w[9]), w[4]);
+  w[12] = SHA_ADD2(SHA_G1(w[10]), w[5]);
+  w[13] = SHA_ADD2(SHA_G1(w[11]), w[6]);
+  w[14] = SHA_ADD3(SHA_G1(w[12]), w[7], SHA_LD_NUM(_sha256_g0(L)));
+  w[15] = SHA_ADD4(SHA_G1(w[13]), w[8], SHA_G0(x), SHA_LD_NUM(L));
+
+  for (int i = 16; i < 64; i += 8) {
+    if (i >= 32) {
+      SHA_WN(w, i + 0);
+      SHA_WN(w, i + 1);
+      SHA_WN(w, i + 2);
+      SHA_WN(w, i + 3);
+      SHA_WN(w, i + 4);
+      SHA_WN(w, i + 5);
+      SHA_WN(w, i + 6);
+      SHA_WN(w, i + 7);
+    }
+
+    SHA_RN(a, b, c, d, e, f, g, h, w[(i + 0) & 15], SHA256_K[i + 0]);
+    SHA_RN(h, a, b, c, d, e, f, g, w[(i + 1) & 15], SHA256_K[i + 1]);
+    SHA_RN(g, h, a, b, c, d, e, f, w[(i + 2) & 15], SHA256_K[i + 2]);
+    SHA_RN(f, g, h, a, b, c, d, e, w[(i + 3) & 15], SHA256_K[i + 3]);
+    SHA_RN(e, f, g, h, a, b, c, d, w[(i + 4) & 15], SHA256_K[i + 4]);
+    SHA_RN(d, e, f, g, h, a, b, c, w[(i + 5) & 15], SHA256_K[i + 5]);
+    SHA_RN(c, d, e, f, g, h, a, b, w[(i + 6) & 15], SHA256_K[i + 6]);
+    SHA_RN(b, c, d, e, f, g, h, a, w[(i + 7) & 15], SHA256_K[i + 7]);
+  }
+
+  s[0] = SHA_ADD2(s[0], a);
+  s[1] = SHA_ADD2(s[1], b);
+  s[2] = SHA_ADD2(s[2], c);
+  s[3] = SHA_ADD2(s[3], d);
+  s[4] = SHA_ADD2(s[4], e);
+  s[5] = SHA_ADD2(s[5], f);
+  s[6] = SHA_ADD2(s[6], g);
+  s[7] = SHA_ADD2(s[7], h);
+}
+
+// hash SHA_LEN padded messages of `size` bytes each (multiple of 64), laid out one after
+// another as in `u8 msg[SHA_LEN][size]`; s[i] gets word i of every digest (native endian)
+void sha256_batch(SHA_VEC s[8], const u8 *msg, const u32 size) {
+  for (int i = 0; i < 8; ++i) s[i] = SHA_LD_NUM(SHA256_IV[i]);
+
+  SHA_VEC w[16];
+  for (u32 offset = 0; offset < size; offset += 64) {
+    const u8 *block = msg + offset;
+    for (int i = 0; i < 16; ++i) w[i] = SHA_SWAP(SHA_LOAD(block, size, i));
+    sha256_block_x(s, w);
+  }
+}
+
+// same as sha256_batch(s, msg, 128) for messages built by prepare65: the first block is
+// hashed as is, the second block only needs its first word from each message
+void sha256_batch65(SHA_VEC s[8], const u8 *msg) {
+  for (int i = 0; i < 8; ++i) s[i] = SHA_LD_NUM(SHA256_IV[i]);
+
+  SHA_VEC w[16];
+  for (int i = 0; i < 16; ++i) w[i] = SHA_SWAP(SHA_LOAD(msg, 128, i));
+  sha256_block_x(s, w);
+  sha256_block_x65(s, SHA_SWAP(SHA_LOAD(msg, 128, 16)));
+}
+
+#endif
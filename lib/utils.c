@@ -21,6 +21,8 @@
   #include <windows.h>
 #else
   #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
   #include <termios.h>
 #endif
 
@@ -70,6 +72,97 @@ char *strtrim(char *str) {
   return str;
 }
 
+// MARK: file helpers
+
+// output files are written to <path>.tmp and renamed over path when complete, so a crash never
+// leaves them half-written, and processes that have the old file mapped keep its pages
+// (truncating a mapped file in place makes readers fault with SIGBUS)
+static char *_tmp_path(const char *path) {
+  char *tmp = malloc(strlen(path) + 5);
+  if (tmp == NULL) {
+    fprintf(stderr, "failed to allocate file path\n");
+    exit(1);
+  }
+
+  sprintf(tmp, "%s.tmp", path);
+  return tmp;
+}
+
+FILE *file_create(const char *path, const char *mode) {
+  char *tmp = _tmp_path(path);
+  FILE *file = fopen(tmp, mode);
+  free(tmp);
+  return file;
+}
+
+// closes file from file_create; if is_ok and all data reached disk, renames it over path,
+// removes it otherwise
+bool file_replace(FILE *file, const char *path, bool is_ok) {
+  char *tmp = _tmp_path(path);
+  is_ok = fflush(file) == 0 && is_ok;
+#ifndef _WIN32
+  is_ok = is_ok && fsync(fileno(file)) == 0;
+#else
+  if (is_ok) remove(path); // rename does not replace existing files on Windows
+#endif
+  is_ok = fclose(file) == 0 && is_ok;
+  is_ok = is_ok && rename(tmp, path) == 0;
+  if (!is_ok) remove(tmp);
+  free(tmp);
+  return is_ok;
+}
+
+#ifndef _WIN32
+// maps whole file read-only and shared, so processes using the same file share one page cache
+// copy; NULL if it can't be mapped or is shorter than min_size (caller's header)
+u8 *file_map(const char *filepath, size_t min_size, bool populate, size_t *map_size) {
+  int fd = open(filepath, O_RDONLY);
+  if (fd < 0) {
+    fprintf(stderr, "failed to open input file\n");
+    return NULL;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < MAX(min_size, 1ul)) {
+    fprintf(stderr, "failed to read input file header\n");
+    close(fd);
+    return NULL;
+  }
+
+  int flags = MAP_SHARED;
+  #ifdef MAP_POPULATE
+  if (populate) flags |= MAP_POPULATE;
+  #endif
+
+  void *map = mmap(NULL, st.st_size, PROT_READ, flags, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    fprintf(stderr, "failed to map input file\n");
+    return NULL;
+  }
+
+  #ifdef MADV_HUGEPAGE
+  madvise(map, st.st_size, MADV_HUGEPAGE); // only a hint, file THP is not always available
+  #endif
+
+  *map_size = st.st_size;
+  return map;
+}
+#endif
+
+// Mark: CPU count
+
+int get_cpu_count() {
+#ifdef _WIN32
+  SYSTEM_INFO sysinfo;
+  GetSystemInfo(&sysinfo);
+  return (int)sysinfo.dwNumberOfProcessors;
+#else
+  int cpu_count = sysconf(_SC_NPROCESSORS_ONLN);
+  return MAX(1, cpu_count);
+#endif
+}
+
 // MARK: random helpers
 
 static FILE *_urandom = NULL;
@@ -305,13 +398,42 @@ void *queue_get(queue_t *q) {
 // MARK: bloom filter
 
 #define BLF_MAGIC 0x45434246 // FourCC: ECBF
-#define BLF_VERSION 1
+#define BLF_VERSION 2
+
+// v1: 20 bits spread over the whole filter (up to 20 cache misses per lookup)
+// v2: blocked, 10 bits in each of two 64-byte lines picked by the hash (2 misses per lookup)
+#define BLF_LINE 8ul // u64 words per line
+#define BLF_LINE_K 10
+
+// file header: magic, version, size (16 bytes); v2 pads it to 64 bytes, so the bits of a
+// mapped file start on a cache line
+#define BLF_HEAD_V1 16
+#define BLF_HEAD_V2 64
 
 typedef struct blf_t {
-  size_t size;
+  size_t size; // in u64 words
   u64 *bits;
+  u32 version;     // 0 is treated as v1
+  void *map;       // file mapping when loaded with blf_map, bits point inside it
+  size_t map_size; // mapping length in bytes
+  hp_kind mem;     // backing of bits otherwise (see hp_alloc)
 } blf_t;
 
+// zeroed filter of `size` words, v2 rounds size up to whole lines aligned to cache lines
+void blf_alloc(blf_t *blf, size_t size, u32 version) {
+  if (version >= 2) size = MAX(BLF_LINE, (size + BLF_LINE - 1) / BLF_LINE * BLF_LINE);
+
+  u64 *bits = hp_alloc(size * sizeof(u64), &blf->mem);
+  if (bits == NULL) {
+    fprintf(stderr, "failed to allocate bloom filter (%'zu bytes)\n", size * sizeof(u64));
+    exit(1);
+  }
+
+  blf->size = size;
+  blf->bits = bits;
+  blf->version = version;
+}
+
 static inline void blf_setbit(blf_t *blf, size_t idx) {
   blf->bits[idx % (blf->size * 64) / 64] |= (u64)1 << (idx % 64);
 }
@@ -320,7 +442,66 @@ static inline bool blf_getbit(blf_t *blf, u64 idx) {
   return (blf->bits[idx % (blf->size * 64) / 64] & ((u64)1 << (idx % 64))) != 0;
 }
 
+// v2 layout: hash[0] and hash[1] pick the lines, hash[2] and hash[4] give the bits in them;
+// bit i is the top 9 bits of x * salt[i] (odd salts, as in split block bloom filters), so the
+// probes are independent for any x (x + i * y repeats positions for some y)
+static const u32 BLF2_SALT[BLF_LINE_K] = {
+    0x47b6137b, 0x44974d91, 0x8824ad5b, 0xa2b7289d, 0x705495c7,
+    0x2df1424b, 0x9efc4947, 0x5c6bfb31, 0x9e3779b1, 0x85ebca6b,
+};
+
+INLINE u64 *blf2_line(const blf_t *blf, u32 h) {
+  return blf->bits + ((u64)h * (blf->size / BLF_LINE) >> 32) * BLF_LINE;
+}
+
+// sets bits of x in line (blf_add_shared collects them in a scratch line first)
+INLINE void blf2_line_set(u64 *line, u32 x) {
+  for (int i = 0; i < BLF_LINE_K; ++i) {
+    u32 p = x * BLF2_SALT[i];
+    line[p >> 29] |= (u64)1 << (p >> 23 & 63);
+  }
+}
+
+INLINE bool blf2_line_has(const u64 *line, u32 x) {
+  u64 acc = 1; // branchless, all probes hit the same cache line anyway
+  for (int i = 0; i < BLF_LINE_K; ++i) {
+    u32 p = x * BLF2_SALT[i];
+    acc &= line[p >> 29] >> (p >> 23 & 63);
+  }
+  return acc & 1;
+}
+
+INLINE void blf2_add(blf_t *blf, const h160_t hash) {
+  blf2_line_set(blf2_line(blf, hash[0]), hash[2]);
+  blf2_line_set(blf2_line(blf, hash[1]), hash[4]);
+}
+
+INLINE bool blf2_has(const blf_t *blf, const h160_t hash) {
+  return blf2_line_has(blf2_line(blf, hash[0]), hash[2]) &&
+         blf2_line_has(blf2_line(blf, hash[1]), hash[4]);
+}
+
+// starts loading cache lines blf_has will read for this hash (to check it later); for v1 only
+// the first 5 probes, most misses stop there
+INLINE void blf_prefetch(const blf_t *blf, const h160_t hash) {
+  if (blf->version >= 2) {
+    __builtin_prefetch(blf2_line(blf, hash[0]));
+    __builtin_prefetch(blf2_line(blf, hash[1]));
+    return;
+  }
+
+  u64 a[6] = {(u64)hash[0] << 32 | hash[1], (u64)hash[2] << 32 | hash[3],
+              (u64)hash[4] << 32 | hash[0], (u64)hash[1] << 32 | hash[2],
+              (u64)hash[3] << 32 | hash[4], (u64)hash[0] << 32 | hash[1]};
+  for (int i = 0; i < 5; ++i) {
+    u64 idx = a[i] << 24 | a[i + 1] >> 24;
+    __builtin_prefetch(&blf->bits[idx % (blf->size * 64) / 64]);
+  }
+}
+
 void blf_add(blf_t *blf, const h160_t hash) {
+  if (blf->version >= 2) return blf2_add(blf, hash);
+
   u64 a1 = (u64)hash[0] << 32 | hash[1];
   u64 a2 = (u64)hash[2] << 32 | hash[3];
   u64 a3 = (u64)hash[4] << 32 | hash[0];
@@ -339,6 +520,8 @@ void blf_add(blf_t *blf, const h160_t hash) {
 }
 
 bool blf_has(blf_t *blf, const h160_t hash) {
+  if (blf->version >= 2) return blf2_has(blf, hash);
+
   u64 a1 = (u64)hash[0] << 32 | hash[1];
   u64 a2 = (u64)hash[2] << 32 | hash[3];
   u64 a3 = (u64)hash[4] << 32 | hash[0];
@@ -362,6 +545,11 @@ bool blf_has(blf_t *blf, const h160_t hash) {
 #include <immintrin.h>
 // vectorized bloom filter check for 4 hashes
 void blf_has4(uint8_t out[4], blf_t *blf, const h160_t *hashes) {
+  if (blf->version >= 2) {
+    for (int i = 0; i < 4; ++i) out[i] = blf2_has(blf, hashes[i]);
+    return;
+  }
+
   __m256i a1 = _mm256_set_epi64x((u64)hashes[3][0] << 32 | hashes[3][1],
                                  (u64)hashes[2][0] << 32 | hashes[2][1],
                                  (u64)hashes[1][0] << 32 | hashes[1][1],
@@ -417,6 +605,11 @@ void blf_has4(uint8_t out[4], blf_t *blf, const h160_t *hashes) {
 #endif
 
 void blf_has8(uint8_t out[8], blf_t *blf, const h160_t *hashes) {
+  if (blf->version >= 2) {
+    for (int i = 0; i < 8; ++i) out[i] = blf2_has(blf, hashes[i]);
+    return;
+  }
+
 #ifdef __AVX2__
   blf_has4(out, blf, hashes);
   blf_has4(out + 4, blf, hashes + 4);
@@ -426,39 +619,38 @@ void blf_has8(uint8_t out[8], blf_t *blf, const h160_t *hashes) {
 }
 
 bool blf_save(const char *filepath, blf_t *blf) {
-  FILE *file = fopen(filepath, "wb");
+  FILE *file = file_create(filepath, "wb"); // see file_replace
   if (file == NULL) {
     fprintf(stderr, "failed to open output file\n");
     exit(1);
   }
 
   u32 blf_magic = BLF_MAGIC;
-  u32 blg_version = BLF_VERSION;
-
-  if (fwrite(&blf_magic, sizeof(blf_magic), 1, file) != 1) {
-    fprintf(stderr, "failed to write bloom filter magic\n");
-    return false;
-  };
-
-  if (fwrite(&blg_version, sizeof(blg_version), 1, file) != 1) {
-    fprintf(stderr, "failed to write bloom filter version\n");
-    return false;
-  }
+  u32 blg_version = MAX(1u, blf->version);
+  u8 pad[BLF_HEAD_V2 - BLF_HEAD_V1] = {0};
 
-  if (fwrite(&blf->size, sizeof(blf->size), 1, file) != 1) {
-    fprintf(stderr, "failed to write bloom filter size\n");
-    return false;
-  }
+  bool is_ok = true;
+  is_ok = is_ok && fwrite(&blf_magic, sizeof(blf_magic), 1, file) == 1;
+  is_ok = is_ok && fwrite(&blg_version, sizeof(blg_version), 1, file) == 1;
+  is_ok = is_ok && fwrite(&blf->size, sizeof(blf->size), 1, file) == 1;
+  is_ok = is_ok && (blg_version < 2 || fwrite(pad, sizeof(pad), 1, file) == 1);
+  is_ok = is_ok && fwrite(blf->bits, sizeof(u64), blf->size, file) == blf->size;
+  is_ok = file_replace(file, filepath, is_ok);
+  if (!is_ok) fprintf(stderr, "failed to write bloom filter\n");
+  return is_ok;
+}
 
-  if (fwrite(blf->bits, sizeof(u64), blf->size, file) != blf->size) {
-    fprintf(stderr, "failed to write bloom filter bits\n");
+bool blf_check_head(u32 blf_magic, u32 blf_version, size_t size) {
+  bool is_v2 = blf_version == 2 && size > 0 && size % BLF_LINE == 0;
+  if (blf_magic != BLF_MAGIC || (blf_version != 1 && !is_v2)) {
+    fprintf(stderr, "invalid bloom filter version; create a new filter with blf-gen command\n");
     return false;
   }
 
-  fclose(file);
   return true;
 }
 
+// reads filter into private memory (needed to update it, see blf-gen)
 bool blf_load(const char *filepath, blf_t *blf) {
   FILE *file = fopen(filepath, "rb");
   if (file == NULL) {
@@ -478,31 +670,248 @@ bool blf_load(const char *filepath, blf_t *blf) {
     return false;
   }
 
-  if (blf_magic != BLF_MAGIC || blf_version != BLF_VERSION) {
-    fprintf(stderr, "invalid bloom filter version; create a new filter with blf-gen command\n");
+  if (!blf_check_head(blf_magic, blf_version, size)) return false;
+  if (blf_version >= 2 && fseek(file, BLF_HEAD_V2, SEEK_SET) != 0) {
+    fprintf(stderr, "failed to read bloom filter header\n");
     return false;
   }
 
-  u64 *bits = calloc(size, sizeof(u64));
-  if (fread(bits, sizeof(u64), size, file) != size) {
+  blf_alloc(blf, size, blf_version);
+  if (fread(blf->bits, sizeof(u64), size, file) != size) {
     fprintf(stderr, "failed to read bloom filter bits\n");
     return false;
   }
 
   fclose(file);
+  return true;
+}
+
+// maps filter file read-only: no copy and no load time, and all processes using the same
+// file share one copy in page cache; populate = prefault all pages now (MAP_POPULATE)
+bool blf_map(const char *filepath, blf_t *blf, bool populate) {
+#ifdef _WIN32
+  (void)populate;
+  return blf_load(filepath, blf);
+#else
+  size_t map_size;
+  u8 *map = file_map(filepath, BLF_HEAD_V1, populate, &map_size);
+  if (map == NULL) return false;
+
+  u32 head[2];
+  size_t size;
+  memcpy(head, map, sizeof(head));
+  memcpy(&size, map + sizeof(head), sizeof(size));
+
+  size_t offset = head[1] >= 2 ? BLF_HEAD_V2 : BLF_HEAD_V1;
+  bool is_ok = blf_check_head(head[0], head[1], size);
+  if (is_ok && map_size < offset + size * sizeof(u64)) {
+    fprintf(stderr, "bloom filter file is truncated\n");
+    is_ok = false;
+  }
+
+  if (!is_ok) {
+    munmap(map, map_size);
+    return false;
+  }
+
   blf->size = size;
-  blf->bits = bits;
+  blf->bits = (u64 *)(map + offset);
+  blf->version = head[1];
+  blf->map = map;
+  blf->map_size = map_size;
   return true;
+#endif
+}
+
+void blf_free(blf_t *blf) {
+#ifndef _WIN32
+  if (blf->map != NULL) munmap(blf->map, blf->map_size);
+#endif
+  if (blf->map == NULL) hp_free(blf->bits, blf->size * sizeof(u64), blf->mem);
+  *blf = (blf_t){0};
+}
+
+// MARK: hash160 input
+
+#define H160_CHUNK (16 * 1024 * 1024) // stdin is read by chunks of this size
+
+INLINE int _hex_digit(u8 c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  c |= 0x20; // lower case
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  return -1;
+}
+
+// parses 40 hex chars, false on invalid char
+INLINE bool h160_from_hex(h160_t out, const u8 *hex) {
+  int bad = 0;
+  for (int i = 0; i < 5; ++i) {
+    u32 w = 0;
+    for (int j = 0; j < 8; ++j) {
+      int d = _hex_digit(hex[i * 8 + j]);
+      bad |= d;
+      w = w << 4 | (u32)(d & 15);
+    }
+    out[i] = w;
+  }
+  return bad >= 0;
+}
+
+// next hash from hex lines or 20-byte big-endian records (binary) in [*pos, end); a line is
+// read from its first 40 hex chars (rest, like a label, is ignored), other lines are skipped
+INLINE bool h160_read(h160_t out, const u8 **pos, const u8 *end, bool binary) {
+  if (binary) {
+    if (end - *pos < 20) return false;
+    const u8 *r = *pos;
+    for (int i = 0; i < 5; ++i, r += 4) out[i] = (u32)r[0] << 24 | r[1] << 16 | r[2] << 8 | r[3];
+    *pos += 20;
+    return true;
+  }
+
+  while (*pos < end) {
+    const u8 *line = *pos;
+    const u8 *nl = memchr(line, '\n', end - line);
+    size_t len = (nl != NULL ? nl : end) - line;
+    *pos = nl != NULL ? nl + 1 : end;
+
+    if (len > 0 && line[len - 1] == '\r') len -= 1;
+    if (len >= 40 && h160_from_hex(out, line)) return true;
+  }
+
+  return false;
+}
+
+typedef struct h160_stream_t {
+  FILE *file;
+  bool binary; // 20-byte records, hex lines otherwise
+  u8 *buf;     // H160_CHUNK bytes
+  size_t len;  // bytes in buf
+  size_t used; // bytes returned by last h160_stream_next
+} h160_stream_t;
+
+// returns size of next chunk at s->buf, it has only whole lines / records; 0 at end of input
+size_t h160_stream_next(h160_stream_t *s) {
+  if (s->buf == NULL) s->buf = malloc(H160_CHUNK);
+  if (s->buf == NULL) {
+    fprintf(stderr, "failed to allocate input buffer\n");
+    exit(1);
+  }
+
+  memmove(s->buf, s->buf + s->used, s->len - s->used);
+  s->len -= s->used;
+  s->len += fread(s->buf + s->len, 1, H160_CHUNK - s->len, s->file);
+  bool is_eof = s->len < H160_CHUNK;
+
+  size_t n = s->len;
+  if (s->binary) {
+    n = n / 20 * 20; // partial record at end of input is dropped
+  } else if (!is_eof) {
+    while (n > 0 && s->buf[n - 1] != '\n') n -= 1; // till last newline
+    if (n == 0) n = s->len;                          // too long line, it's cut here
+  }
+
+  s->used = n;
+  return n;
+}
+
+void h160_stream_free(h160_stream_t *s) {
+  free(s->buf);
+  s->buf = NULL;
+}
+
+// reads all hashes from file (hex lines or binary records) to malloc'ed array
+h160_t *h160_read_all(FILE *file, bool binary, size_t *count) {
+  h160_stream_t in = {.file = file, .binary = binary};
+  size_t capacity = 1024, size = 0, len;
+  h160_t *hashes = malloc(capacity * sizeof(h160_t));
+
+  while (hashes != NULL && (len = h160_stream_next(&in)) != 0) {
+    const u8 *pos = in.buf, *end = in.buf + len;
+    h160_t hash;
+    while (hashes != NULL && h160_read(hash, &pos, end, binary)) {
+      if (size >= capacity) {
+        capacity *= 2;
+        hashes = realloc(hashes, capacity * sizeof(h160_t));
+        if (hashes == NULL) break;
+      }
+      memcpy(hashes[size++], hash, sizeof(h160_t));
+    }
+  }
+
+  h160_stream_free(&in);
+  if (hashes == NULL) {
+    fprintf(stderr, "failed to allocate hashes list\n");
+    exit(1);
+  }
+
+  *count = size;
+  return hashes;
 }
 
 // MARK: blf-gen command
 
+// atomic version of blf_add (filter shared by builder threads); true if any bit was not set before
+bool blf_add_shared(blf_t *blf, const h160_t hash) {
+  u64 added = 0;
+
+  if (blf->version >= 2) {
+    for (int k = 0; k < 2; ++k) {
+      u64 *line = blf2_line(blf, hash[k]), w[BLF_LINE] = {0};
+      blf2_line_set(w, hash[2 + 2 * k]);
+      for (size_t i = 0; i < BLF_LINE; ++i) {
+        if (w[i] != 0) added |= ~__atomic_fetch_or(&line[i], w[i], __ATOMIC_RELAXED) & w[i];
+      }
+    }
+    return added != 0;
+  }
+
+  u64 a[6] = {(u64)hash[0] << 32 | hash[1], (u64)hash[2] << 32 | hash[3],
+              (u64)hash[4] << 32 | hash[0], (u64)hash[1] << 32 | hash[2],
+              (u64)hash[3] << 32 | hash[4], (u64)hash[0] << 32 | hash[1]};
+
+  u8 shifts[4] = {24, 28, 36, 40};
+  for (size_t i = 0; i < 4; ++i) {
+    u8 S = shifts[i];
+    for (int j = 0; j < 5; ++j) {
+      u64 idx = a[j] << S | a[j + 1] >> S;
+      u64 bit = (u64)1 << (idx % 64);
+      u64 *word = &blf->bits[idx % (blf->size * 64) / 64];
+      added |= ~__atomic_fetch_or(word, bit, __ATOMIC_RELAXED) & bit;
+    }
+  }
+  return added != 0;
+}
+
+typedef struct blf_gen_job_t {
+  blf_t *blf;
+  const u8 *data; // whole lines / records
+  size_t size;
+  bool binary;
+  u64 total; // hashes read
+  u64 added; // hashes not in filter before
+} blf_gen_job_t;
+
+void *blf_gen_worker(void *arg) {
+  blf_gen_job_t *job = (blf_gen_job_t *)arg;
+  const u8 *pos = job->data, *end = job->data + job->size;
+
+  h160_t hash;
+  while (h160_read(hash, &pos, end, job->binary)) {
+    job->total += 1;
+    job->added += blf_add_shared(job->blf, hash);
+  }
+
+  return NULL;
+}
+
 void __blf_gen_usage(args_t *args) {
   printf("Usage: %s blf-gen -n <count> -o <file>\n", args->argv[0]);
   printf("Generate a bloom filter from a list of hex-encoded hash160 values passed to stdin.\n");
   printf("\nOptions:\n");
   printf("  -n <count>      - Number of hashes to add.\n");
   printf("  -o <file>       - File to write bloom filter (must have a .blf extension).\n");
+  printf("  -t <threads>    - Number of threads to use (default: all CPUs).\n");
+  printf("  -bin            - Read binary 20-byte hash160 records instead of hex lines.\n");
   exit(1);
 }
 
@@ -523,10 +932,13 @@ void blf_gen(args_t *args) {
   u64 r = 1e9;
   double p = 1.0 / (double)r;
   u64 m = (u64)(n * log(p) / log(1.0 / pow(2.0, log(2.0))));
-  double mb = (double)m / 8 / 1024 / 1024;
   size_t size = (m + 63) / 64;
 
-  blf_t blf = {.size = 0, .bits = NULL};
+  // blocked filter loses some accuracy to uneven line load, 20% more bits make up for it
+  size_t size_v2 = (size_t)(size * 1.2);
+  size_v2 = MAX(BLF_LINE, (size_v2 + BLF_LINE - 1) / BLF_LINE * BLF_LINE);
+
+  blf_t blf = {.size = 0, .bits = NULL, .version = BLF_VERSION};
   if (access(filepath, F_OK) == 0) {
     char *todo = "delete it or choose a different file";
     printf("file %s already exists; loading...\n", filepath);
@@ -536,42 +948,64 @@ void blf_gen(args_t *args) {
       exit(1);
     }
 
-    if (blf.size != size) {
-      fprintf(stderr, "[!] bloom filter size mismatch (%'zu != %'zu): %s\n", blf.size, size, todo);
+    size_t need = blf.version >= 2 ? size_v2 : size;
+    if (blf.size != need) {
+      fprintf(stderr, "[!] bloom filter size mismatch (%'zu != %'zu): %s\n", blf.size, need, todo);
       exit(1);
     }
 
-    printf("updating bloom filter...\n");
+    printf("updating bloom filter (v%u)...\n", blf.version);
   } else {
-    printf("creating bloom filter...\n");
-    blf.size = size;
-    blf.bits = calloc(blf.size, sizeof(u64));
+    printf("creating bloom filter (v%u)...\n", blf.version);
+    blf_alloc(&blf, size_v2, blf.version);
   }
 
+  m = blf.size * 64;
+  double mb = (double)m / 8 / 1024 / 1024;
   printf("bloom filter params: n = %'llu | p = 1:%'llu | m = %'llu (%'.1f MB)\n", n, r, m, mb);
 
-  u64 count = 0;
-  hex40 line;
-  while (fgets(line, sizeof(line), stdin) != NULL) {
-    if (strlen(line) != sizeof(line) - 1) continue;
-
-    h160_t hash;
-    for (size_t j = 0; j < sizeof(line) - 1; j += 8) sscanf(line + j, "%8x", &hash[j / 8]);
+  // each chunk of stdin is split between threads by whole lines / records, and threads set bits
+  // with atomic OR; hashes are uniform, so contention on the same word is rare
+  size_t threads_count = MIN(MAX(args_uint(args, "-t", get_cpu_count()), 1ul), 320ul);
+  pthread_t threads[threads_count];
+  blf_gen_job_t jobs[threads_count];
+
+  h160_stream_t in = {.file = stdin, .binary = args_bool(args, "-bin")};
+  u64 total = 0, count = 0;
+  size_t len;
+  while ((len = h160_stream_next(&in)) != 0) {
+    size_t from = 0;
+    for (size_t i = 0; i < threads_count; ++i) {
+      size_t till = len * (i + 1) / threads_count;
+      if (in.binary) till = till / 20 * 20;
+      else if (till < len) {
+        u8 *nl = memchr(in.buf + till, '\n', len - till);
+        till = nl != NULL ? (size_t)(nl - in.buf) + 1 : len;
+      }
+      till = i + 1 == threads_count ? len : MAX(from, till);
 
-    if (blf_has(&blf, hash)) continue;
+      jobs[i] = (blf_gen_job_t){
+          .blf = &blf, .data = in.buf + from, .size = till - from, .binary = in.binary};
+      pthread_create(&threads[i], NULL, blf_gen_worker, &jobs[i]);
+      from = till;
+    }
 
-    blf_add(&blf, hash);
-    count += 1;
+    for (size_t i = 0; i < threads_count; ++i) {
+      pthread_join(threads[i], NULL);
+      total += jobs[i].total;
+      count += jobs[i].added;
+    }
   }
 
-  printf("added %'llu new items; saving to %s\n", count, filepath);
+  h160_stream_free(&in);
+  printf("read %'llu hashes, added %'llu new items; saving to %s\n", total, count, filepath);
 
   if (!blf_save(filepath, &blf)) {
     fprintf(stderr, "[!] failed to save bloom filter\n");
     exit(1);
   }
 
-  free(blf.bits);
+  blf_free(&blf);
 }
 
 // MARK: blf-check command
@@ -601,7 +1035,7 @@ void blf_check(args_t *args) {
   }
 
   blf_t blf = {.size = 0, .bits = NULL};
-  if (!blf_load(filepath, &blf)) {
+  if (!blf_map(filepath, &blf, false)) {
     fprintf(stderr, "[!] failed to load bloom filter\n");
     exit(1);
   }
@@ -628,19 +1062,6 @@ void blf_check(args_t *args) {
   }
 }
 
-// Mark: CPU count
-
-int get_cpu_count() {
-#ifdef _WIN32
-  SYSTEM_INFO sysinfo;
-  GetSystemInfo(&sysinfo);
-  return (int)sysinfo.dwNumberOfProcessors;
-#else
-  int cpu_count = sysconf(_SC_NPROCESSORS_ONLN);
-  return MAX(1, cpu_count);
-#endif
-}
-
 // MARK: TTY
 
 typedef void (*tty_cb_t)(void *ctx, const char ch);
@@ -5,41 +5,80 @@
 #include <locale.h>
 #include <pthread.h>
 #include <signal.h>
+#include <stdatomic.h>
 #include <unistd.h>
 
 #include "lib/addr.c"
 #include "lib/bench.c"
+#include "lib/bff.c"
 #include "lib/ecc.c"
+#include "lib/ecc_ifma.c"
+#include "lib/hset.c"
 #include "lib/utils.c"
 
 #define VERSION "0.5.0"
 #define MAX_JOB_SIZE 1024 * 1024 * 2
-#define GROUP_INV_SIZE 2048ul
+#define GROUP_INV_SIZE 2048ul // default group size (-g)
+#define MIN_GROUP_SIZE 64ul
+#define MAX_GROUP_SIZE 65536ul
 #define MAX_LINE_SIZE 1025
+#define CHECKPOINT_SECS 30 // seconds between checkpoint writes (-resume)
 
 static_assert(GROUP_INV_SIZE % HASH_BATCH_SIZE == 0,
               "GROUP_INV_SIZE must be divisible by HASH_BATCH_SIZE");
+static_assert(MIN_GROUP_SIZE % HASH_BATCH_SIZE == 0,
+              "MIN_GROUP_SIZE must be divisible by HASH_BATCH_SIZE");
 
 enum Cmd { CMD_NIL, CMD_ADD, CMD_MUL, CMD_RND };
 
+// per-thread state; k_checked is written by its thread after every job and read by the
+// reporter, so it is padded on both sides to never share a cache line with other threads
+// (malloc does not guarantee 64-byte alignment of the array)
+typedef struct worker_t {
+  struct ctx_t *ctx;
+  size_t idx;
+  size_t jobs;    // sub-ranges processed by this thread
+  size_t ts_busy; // time spent in batch routines (ms)
+  atomic_size_t job_cur; // lower bound of job index in progress, SIZE_MAX when idle (cmd add)
+  char _pad1[64];
+  atomic_size_t k_checked; // keys checked by this thread
+  char _pad2[64 - sizeof(atomic_size_t)];
+} worker_t;
+
+// found key, passed from worker to reporter thread
+typedef struct found_t {
+  struct found_t *next;
+  const char *label;
+  h160_t hash;
+  fe pk;
+} found_t;
+
 typedef struct ctx_t {
   enum Cmd cmd;
   pthread_mutex_t lock;
   size_t threads_count;
   pthread_t *threads;
-  size_t k_checked;
-  size_t k_found;
+  worker_t *workers; // per-thread counters and stats
+  size_t k_checked;      // sum of workers counters (updated by reporter)
+  atomic_size_t k_found; // keys found (written to output by reporter)
   bool check_addr33;
   bool check_addr65;
   bool use_endo;
+  size_t group_size; // points per group inversion (-g)
 
   FILE *outfile;
   bool quiet;
   u32 print_secs; // seconds between status prints
   bool use_color;
 
-  bool finished;       // true if the program is exiting
-  bool paused;         // true if the program is paused
+  // reporter thread owns all status and found keys output, workers never wait for it
+  pthread_t reporter;
+  pthread_cond_t report_cond;      // wakes reporter before next print tick
+  _Atomic(found_t *) found_head;   // found keys to write (newest first)
+  struct rnd_range_t *rnd_ranges; // random ranges to report (cmd rnd, guarded by lock)
+
+  atomic_bool finished; // true if the program is exiting
+  atomic_bool paused;   // true if the program is paused
   size_t ts_started;   // timestamp of start
   size_t ts_updated;   // timestamp of last update
   size_t ts_printed;   // timestamp of last print
@@ -47,17 +86,27 @@ typedef struct ctx_t {
   size_t paused_time;  // time spent in paused state
 
   // filter file (bloom filter or hashes to search)
-  h160_t *to_find_hashes;
-  size_t to_find_count;
+  hset_t hset; // exact list of hashes (text file), used instead of filters when loaded
   blf_t blf;
+  bff_t bff; // binary fuse filter (.bff), used instead of bloom filter when loaded
+  bool populate; // prefault mapped filter pages on load (-populate)
 
   // cmd add
   fe range_s;  // search range start
   fe range_e;  // search range end
   fe stride_k; // precomputed stride key (step for G-points, 2^offset)
   pe stride_p; // precomputed stride point (G * pk)
-  pe gpoints[GROUP_INV_SIZE];
+  pe *gpoints; // group_size points: K+1 .. K+N/2, K-1 .. K-N/2
   size_t job_size;
+  fe job_inc;              // pk step between jobs (job_size * stride)
+  atomic_size_t job_next; // index of next job to claim (cmd add)
+
+  // checkpoint (-resume), written by reporter; jobs below frontier are all completed
+  char *ckpt_path;       // checkpoint file, NULL when disabled
+  fe ckpt_range_s;       // range start of the first run (range_s is moved on resume)
+  pthread_mutex_t ckpt_lock; // serializes writes by reporter and SIGINT listener
+  atomic_bool ckpt_ready;    // add jobs are running, so frontier can be computed
+  size_t ts_ckpt;        // timestamp of last checkpoint write
 
   // cmd mul
   queue_t queue;
@@ -69,12 +118,6 @@ typedef struct ctx_t {
   u32 ord_size; // size (span) in range to search
 } ctx_t;
 
-typedef struct add_job_t {
-  ctx_t *ctx;
-  fe start;
-  fe end;
-} add_job_t;
-
 void load_filter(ctx_t *ctx, const char *filepath) {
   if (!filepath) {
     fprintf(stderr, "missing filter file\n");
@@ -89,52 +132,37 @@ void load_filter(ctx_t *ctx, const char *filepath) {
 
   char *ext = strrchr(filepath, '.');
   if (ext != NULL && strcmp(ext, ".blf") == 0) {
-    if (!blf_load(filepath, &ctx->blf)) exit(1);
+    // huge pages can't back a file mapping, so read filter into (huge page) memory instead
+    bool is_ok = _HUGE_PAGES ? blf_load(filepath, &ctx->blf)
+                             : blf_map(filepath, &ctx->blf, ctx->populate);
+    if (!is_ok) exit(1);
     fclose(file);
     return;
   }
 
-  size_t hlen = sizeof(u32) * 5;
-  assert(hlen == sizeof(h160_t));
-  size_t capacity = 32;
-  size_t size = 0;
-  u32 *hashes = malloc(capacity * hlen);
-
-  hex40 line;
-  while (fgets(line, sizeof(line), file)) {
-    if (strlen(line) != sizeof(line) - 1) continue;
-
-    if (size >= capacity) {
-      capacity *= 2;
-      hashes = realloc(hashes, capacity * hlen);
-    }
-
-    for (size_t j = 0; j < sizeof(line) - 1; j += 8) {
-      sscanf(line + j, "%8x", &hashes[size * 5 + j / 8]);
-    }
+  if (ext != NULL && strcmp(ext, ".bff") == 0) {
+    if (!bff_load(filepath, &ctx->bff)) exit(1);
+    fclose(file);
+    return;
+  }
 
-    size += 1;
+  if (ext != NULL && strcmp(ext, ".h160") == 0) {
+    bool is_ok = _HUGE_PAGES ? hset_load(filepath, &ctx->hset)
+                             : hset_map(filepath, &ctx->hset, ctx->populate);
+    if (!is_ok) exit(1);
+    fclose(file);
+    return;
   }
 
+  size_t count;
+  h160_t *hashes = h160_read_all(file, false, &count);
   fclose(file);
-  qsort(hashes, size, hlen, compare_160);
-
-  // remove duplicates
-  size_t unique_count = 0;
-  for (size_t i = 1; i < size; ++i) {
-    if (memcmp(&hashes[unique_count * 5], &hashes[i * 5], hlen) != 0) {
-      unique_count++;
-      memcpy(&hashes[unique_count * 5], &hashes[i * 5], hlen);
-    }
+  if (count == 0) {
+    fprintf(stderr, "no hashes in %s; each line must start with 40 hex chars\n", filepath);
+    exit(1);
   }
 
-  ctx->to_find_hashes = (h160_t *)hashes;
-  ctx->to_find_count = unique_count + 1;
-
-  // generate in-memory bloom filter
-  ctx->blf.size = ctx->to_find_count * 2;
-  ctx->blf.bits = malloc(ctx->blf.size * sizeof(u64));
-  for (size_t i = 0; i < ctx->to_find_count; ++i) blf_add(&ctx->blf, hashes + i * 5);
+  hset_init(&ctx->hset, hashes, count);
 }
 
 // note: this function is not thread-safe; use mutex lock before calling
@@ -163,65 +191,244 @@ void ctx_check_paused(ctx_t *ctx) {
   }
 }
 
-void ctx_update(ctx_t *ctx, size_t k_checked) {
-  size_t ts = tsnow();
+// called by worker after each job; no locks, only own padded counter is touched
+void worker_update(worker_t *w, size_t k_checked) {
+  atomic_fetch_add_explicit(&w->k_checked, k_checked, memory_order_relaxed);
+  ctx_check_paused(w->ctx);
+}
+
+void ctx_print_workers(ctx_t *ctx) {
+  if (ctx->quiet || ctx->workers == NULL) return;
+
+  size_t k_total = 0;
+  for (size_t i = 0; i < ctx->threads_count; ++i) k_total += ctx->workers[i].k_checked;
+
+  for (size_t i = 0; i < ctx->threads_count; ++i) {
+    worker_t *w = &ctx->workers[i];
+    size_t k_checked = w->k_checked;
+    double dt = MAX(w->ts_busy, 1ul) / 1000.0;
+    double share = k_total ? 100.0 * k_checked / k_total : 0;
+    fprintf(stderr, "thread %3zu: %.2f Mkeys/s ~ %'zu jobs ~ %'zu keys (%.1f%%)\n", //
+            i, k_checked / dt / 1000000, w->jobs, k_checked, share);
+  }
+}
+
+void ctx_write_found(ctx_t *ctx, const char *label, const h160_t hash, const fe pk) {
+  found_t *found = malloc(sizeof(found_t));
+  if (found == NULL) {
+    fprintf(stderr, "failed to allocate found key\n");
+    exit(1);
+  }
+
+  found->label = label;
+  memcpy(found->hash, hash, sizeof(h160_t));
+  fe_clone(found->pk, pk);
+
+  // lock-free push, reporter takes the whole list at once
+  found->next = atomic_load(&ctx->found_head);
+  while (!atomic_compare_exchange_weak(&ctx->found_head, &found->next, found)) {
+  }
+
+  atomic_fetch_add(&ctx->k_found, 1);
+  pthread_cond_signal(&ctx->report_cond);
+}
+
+// note: called by reporter with ctx->lock held
+void ctx_flush_found(ctx_t *ctx) {
+  found_t *list = atomic_exchange(&ctx->found_head, NULL);
+
+  found_t *prev = NULL; // restore order of finding
+  while (list != NULL) {
+    found_t *next = list->next;
+    list->next = prev;
+    prev = list;
+    list = next;
+  }
+
+  while (prev != NULL) {
+    found_t *found = prev;
+    const u32 *hash = found->hash;
+    const u64 *pk = found->pk;
+
+    if (!ctx->quiet) {
+      term_clear_line();
+      printf("%s: %08x%08x%08x%08x%08x <- %016llx%016llx%016llx%016llx\n", //
+             found->label, hash[0], hash[1], hash[2], hash[3], hash[4],    //
+             pk[3], pk[2], pk[1], pk[0]);
+    }
+
+    if (ctx->outfile != NULL) {
+      fprintf(ctx->outfile, "%s\t%08x%08x%08x%08x%08x\t%016llx%016llx%016llx%016llx\n", //
+              found->label, hash[0], hash[1], hash[2], hash[3], hash[4],                //
+              pk[3], pk[2], pk[1], pk[0]);
+      fflush(ctx->outfile);
+    }
+
+    prev = found->next;
+    free(found);
+  }
+}
+
+void rnd_ranges_report(ctx_t *ctx);
+void ctx_checkpoint_save(ctx_t *ctx);
+
+void *ctx_reporter(void *arg) {
+  ctx_t *ctx = (ctx_t *)arg;
 
   pthread_mutex_lock(&ctx->lock);
-  bool need_print = (ts - ctx->ts_printed) >= (size_t)ctx->print_secs * 1000;
-  ctx->k_checked += k_checked;
-  ctx->ts_updated = ts;
-  if (need_print) {
-    ctx->ts_printed = ts;
-    ctx_print_unlocked(ctx);
+  while (true) {
+    bool is_last = ctx->finished; // workers are joined, this is final pass
+
+    size_t k_checked = 0;
+    for (size_t i = 0; i < ctx->threads_count; ++i) k_checked += ctx->workers[i].k_checked;
+
+    size_t ts = tsnow();
+    bool has_found = atomic_load(&ctx->found_head) != NULL;
+    ctx->k_checked = k_checked;
+    ctx->ts_updated = ts;
+
+    ctx_flush_found(ctx);
+    if (ctx->rnd_ranges != NULL) rnd_ranges_report(ctx);
+
+    if (ctx->ckpt_path != NULL && (is_last || ts - ctx->ts_ckpt >= CHECKPOINT_SECS * 1000)) {
+      ctx->ts_ckpt = ts;
+      ctx_checkpoint_save(ctx);
+    }
+
+    if (is_last) break;
+    if (has_found || (ts - ctx->ts_printed) >= (size_t)ctx->print_secs * 1000) {
+      ctx->ts_printed = ts;
+      ctx_print_unlocked(ctx);
+    }
+
+    struct timespec until;
+    clock_gettime(CLOCK_REALTIME, &until);
+    until.tv_nsec += 100 * 1000000;
+    if (until.tv_nsec >= 1000000000) until.tv_sec += 1, until.tv_nsec -= 1000000000;
+    pthread_cond_timedwait(&ctx->report_cond, &ctx->lock, &until);
   }
+
+  ctx_print_unlocked(ctx);
+  ctx_print_workers(ctx);
   pthread_mutex_unlock(&ctx->lock);
+  return NULL;
+}
+
+// allocate per-thread counters and start reporter thread
+void ctx_start(ctx_t *ctx) {
+  free(ctx->workers);
+  ctx->workers = calloc(ctx->threads_count, sizeof(worker_t));
+  for (size_t i = 0; i < ctx->threads_count; ++i) {
+    ctx->workers[i].ctx = ctx;
+    ctx->workers[i].idx = i;
+    ctx->workers[i].job_cur = SIZE_MAX;
+  }
 
-  ctx_check_paused(ctx);
+  ctx->finished = false;
+  ctx->ts_started = tsnow(); // actual start time
+  ctx->ts_ckpt = ctx->ts_started;
+  pthread_create(&ctx->reporter, NULL, ctx_reporter, ctx);
 }
 
+// note: call after all workers are joined
 void ctx_finish(ctx_t *ctx) {
   pthread_mutex_lock(&ctx->lock);
   ctx->finished = true;
-  ctx_print_unlocked(ctx);
-  if (ctx->outfile != NULL) fclose(ctx->outfile);
+  pthread_cond_signal(&ctx->report_cond);
   pthread_mutex_unlock(&ctx->lock);
+
+  pthread_join(ctx->reporter, NULL);
+  if (ctx->outfile != NULL) fclose(ctx->outfile), ctx->outfile = NULL;
 }
 
-void ctx_write_found(ctx_t *ctx, const char *label, const h160_t hash, const fe pk) {
-  pthread_mutex_lock(&ctx->lock);
+INLINE bool ctx_has_filter(ctx_t *ctx) {
+  return ctx->hset.buckets != NULL || ctx->blf.bits != NULL || ctx->bff.fp != NULL;
+}
 
-  if (!ctx->quiet) {
-    term_clear_line();
-    printf("%s: %08x%08x%08x%08x%08x <- %016llx%016llx%016llx%016llx\n", //
-           label, hash[0], hash[1], hash[2], hash[3], hash[4],           //
-           pk[3], pk[2], pk[1], pk[0]);
-  }
+// filter check: exact with list of hashes, probabilistic with binary fuse or bloom filter
+INLINE bool ctx_filter(ctx_t *ctx, const h160_t h) {
+  if (ctx->hset.buckets != NULL) return hset_has(&ctx->hset, h);
+  return ctx->bff.fp != NULL ? bff_has(&ctx->bff, h) : blf_has(&ctx->blf, h);
+}
+
+// same for 8 hashes at once, out[i] is 0 when hashes[i] is not in the filter
+INLINE void ctx_filter8(ctx_t *ctx, uint8_t out[8], const h160_t *hashes) {
+  if (ctx->hset.buckets != NULL) hset_has8(out, &ctx->hset, hashes);
+  else if (ctx->bff.fp != NULL) bff_has8(out, &ctx->bff, hashes);
+  else blf_has8(out, &ctx->blf, hashes);
+}
 
-  if (ctx->outfile != NULL) {
-    fprintf(ctx->outfile, "%s\t%08x%08x%08x%08x%08x\t%016llx%016llx%016llx%016llx\n", //
-            label, hash[0], hash[1], hash[2], hash[3], hash[4],                       //
-            pk[3], pk[2], pk[1], pk[0]);
-    fflush(ctx->outfile);
+bool ctx_check_hash(ctx_t *ctx, const h160_t h) { return ctx_filter(ctx, h); }
+
+INLINE void ctx_prefetch(ctx_t *ctx, const h160_t *hashes, size_t count) {
+  if (ctx->hset.buckets != NULL) {
+    for (size_t i = 0; i < count; ++i) hset_prefetch(&ctx->hset, hashes[i]);
+  } else if (ctx->bff.fp != NULL) {
+    for (size_t i = 0; i < count; ++i) bff_prefetch(&ctx->bff, hashes[i]);
+  } else if (ctx->blf.bits != NULL) {
+    for (size_t i = 0; i < count; ++i) blf_prefetch(&ctx->blf, hashes[i]);
   }
+}
 
-  ctx->k_found += 1;
-  ctx_print_unlocked(ctx);
+// filter check of `count` hashes, out[i] is 0 when hashes[i] is not in the filter
+void ctx_filter_batch(ctx_t *ctx, u8 *out, const h160_t *hashes, size_t count) {
+  if (!ctx_has_filter(ctx)) return (void)memset(out, 1, count);
 
-  pthread_mutex_unlock(&ctx->lock);
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) ctx_filter8(ctx, out + i, hashes + i);
+  for (; i < count; ++i) out[i] = ctx_filter(ctx, hashes[i]);
 }
 
-bool ctx_check_hash(ctx_t *ctx, const h160_t h) {
-  // bloom filter only mode
-  if (ctx->to_find_hashes == NULL) {
-    return blf_has(&ctx->blf, h);
-  }
+// Hashes are checked one batch behind: filter lines of a batch are prefetched right after it is
+// hashed and tested after hashing of the next batch, so cache misses overlap with sha256/rmd160
+// instead of stalling on every probe.
+
+typedef struct hash_batch_t {
+  h160_t hs33[HASH_BATCH_SIZE];
+  h160_t hs65[HASH_BATCH_SIZE];
+  u8 m33[HASH_BATCH_SIZE]; // 0 - hash is not in the filter (or addr33 not checked)
+  u8 m65[HASH_BATCH_SIZE];
+  size_t offs; // index of first point (as passed to hash_pipe_push)
+  size_t count;
+} hash_batch_t;
+
+typedef struct hash_pipe_t {
+  hash_batch_t b[2];
+  size_t n; // batches pushed
+} hash_pipe_t;
+
+void hash_batch_filter(ctx_t *ctx, hash_batch_t *hb) {
+  memset(hb->m33, 0, sizeof(hb->m33));
+  memset(hb->m65, 0, sizeof(hb->m65));
+  if (ctx->check_addr33) ctx_filter_batch(ctx, hb->m33, hb->hs33, hb->count);
+  if (ctx->check_addr65) ctx_filter_batch(ctx, hb->m65, hb->hs65, hb->count);
+}
 
-  // check by hashes list
-  if (!blf_has(&ctx->blf, h)) return false; // fast check with bloom filter
+// hashes `count` points and prefetches their filter lines; returns previous batch with filter
+// results or NULL (first push)
+hash_batch_t *hash_pipe_push(ctx_t *ctx, hash_pipe_t *pipe, const pe_batch_t points, size_t offs,
+                             size_t count) {
+  hash_batch_t *hb = &pipe->b[pipe->n++ & 1];
+  hb->offs = offs;
+  hb->count = count;
+  if (ctx->check_addr33) hash160_batch(hb->hs33, points, count, true);
+  if (ctx->check_addr65) hash160_batch(hb->hs65, points, count, false);
+  if (ctx->check_addr33) ctx_prefetch(ctx, hb->hs33, count);
+  if (ctx->check_addr65) ctx_prefetch(ctx, hb->hs65, count);
+
+  if (pipe->n < 2) return NULL;
+  hb = &pipe->b[pipe->n & 1];
+  hash_batch_filter(ctx, hb);
+  return hb;
+}
 
-  // if bloom filter check passed, do full check
-  h160_t *rs = bsearch(h, ctx->to_find_hashes, ctx->to_find_count, sizeof(h160_t), compare_160);
-  return rs != NULL;
+// returns last pushed batch with filter results (or NULL) and resets pipe
+hash_batch_t *hash_pipe_flush(ctx_t *ctx, hash_pipe_t *pipe) {
+  if (pipe->n == 0) return NULL;
+  hash_batch_t *hb = &pipe->b[(pipe->n - 1) & 1];
+  hash_batch_filter(ctx, hb);
+  pipe->n = 0;
+  return hb;
 }
 
 void ctx_precompute_gpoints(ctx_t *ctx) {
@@ -230,14 +437,19 @@ void ctx_precompute_gpoints(ctx_t *ctx) {
   fe_shiftl(ctx->stride_k, ctx->ord_offs);
 
   fe t; // precalc stride point
-  fe_modn_add_stride(t, FE_ZERO, ctx->stride_k, GROUP_INV_SIZE);
-  ec_jacobi_mulrdc(&ctx->stride_p, &G1, t); // G * (GROUP_INV_SIZE * gs)
+  fe_modn_add_stride(t, FE_ZERO, ctx->stride_k, ctx->group_size);
+  ec_jacobi_mulrdc(&ctx->stride_p, &G1, t); // G * (group_size * gs)
 
   pe g1, g2;
   ec_jacobi_mulrdc(&g1, &G1, ctx->stride_k);
   ec_jacobi_dblrdc(&g2, &g1);
 
-  size_t hsize = GROUP_INV_SIZE / 2;
+  size_t hsize = ctx->group_size / 2;
+  ctx->gpoints = realloc(ctx->gpoints, ctx->group_size * sizeof(pe));
+  if (ctx->gpoints == NULL) {
+    fprintf(stderr, "failed to allocate group points\n");
+    exit(1);
+  }
 
   // K+1, K+2, .., K+N/2-1
   pe_clone(ctx->gpoints + 0, &g1);
@@ -292,31 +504,28 @@ void check_hash(ctx_t *ctx, bool c, const h160_t h, const fe start_pk, u64 pk_of
   ctx_write_found(ctx, c ? "addr33" : "addr65", h, ck);
 }
 
-void check_found_add(ctx_t *ctx, fe const start_pk, const pe *points) {
-  h160_t hs33[HASH_BATCH_SIZE];
-  h160_t hs65[HASH_BATCH_SIZE];
+// endo = false: hb->offs + k is point index; true: index in endos (5 per point, see below)
+void check_batch_add(ctx_t *ctx, const fe start_pk, const hash_batch_t *hb, bool endo) {
+  if (hb == NULL) return;
 
-  for (size_t i = 0; i < GROUP_INV_SIZE; i += HASH_BATCH_SIZE) {
-    if (ctx->check_addr33) addr33_batch(hs33, points + i, HASH_BATCH_SIZE);
-    if (ctx->check_addr65) addr65_batch(hs65, points + i, HASH_BATCH_SIZE);
-    for (size_t j = 0; j < HASH_BATCH_SIZE; j += 8) {
-      uint8_t mask33[8] = {1,1,1,1,1,1,1,1};
-      uint8_t mask65[8] = {1,1,1,1,1,1,1,1};
-      size_t remain = MIN(8ul, HASH_BATCH_SIZE - j);
-      if (ctx->blf.bits != NULL) {
-        if (ctx->check_addr33)
-          blf_has8(mask33, &ctx->blf, (const h160_t *)(hs33 + j));
-        if (ctx->check_addr65)
-          blf_has8(mask65, &ctx->blf, (const h160_t *)(hs65 + j));
-      }
-      for (size_t k = 0; k < remain; ++k) {
-        if (ctx->check_addr33 && (ctx->blf.bits == NULL || mask33[k]))
-          check_hash(ctx, true, hs33[j + k], start_pk, i + j + k, 0);
-        if (ctx->check_addr65 && (ctx->blf.bits == NULL || mask65[k]))
-          check_hash(ctx, false, hs65[j + k], start_pk, i + j + k, 0);
-      }
-    }
+  for (size_t k = 0; k < hb->count; ++k) {
+    size_t ci = hb->offs + k;
+    u64 pk_off = endo ? ci / 5 : ci;
+    size_t ek = endo ? (ci % 5) + 1 : 0;
+    if (hb->m33[k]) check_hash(ctx, true, hb->hs33[k], start_pk, pk_off, ek);
+    if (hb->m65[k]) check_hash(ctx, false, hb->hs65[k], start_pk, pk_off, ek);
+  }
+}
+
+void check_found_add(ctx_t *ctx, fe const start_pk, const pe_batch_t points) {
+  hash_pipe_t pipe = {0};
+  hash_batch_t *hb;
+
+  for (size_t i = 0; i < ctx->group_size; i += HASH_BATCH_SIZE) {
+    hb = hash_pipe_push(ctx, &pipe, pe_batch_at(points, i), i, HASH_BATCH_SIZE);
+    check_batch_add(ctx, start_pk, hb, false);
   }
+  check_batch_add(ctx, start_pk, hash_pipe_flush(ctx, &pipe), false);
 
   if (!ctx->use_endo) return;
 
@@ -325,67 +534,78 @@ void check_found_add(ctx_t *ctx, fe const start_pk, const pe *points) {
   // PrivKeys = (pk) (!pk) (pk*alpha) !(pk*alpha) (pk*alpha^2) !(pk*alpha^2)
 
   size_t esize = HASH_BATCH_SIZE * 5;
-  pe endos[esize];
-  for (size_t i = 0; i < esize; ++i) fe_set64(endos[i].z, 1);
+  fe ex[esize], ey[esize];
+  pe_batch_t endos = {.x = ex, .y = ey};
 
   size_t ci = 0;
-  for (size_t k = 0; k < GROUP_INV_SIZE; ++k) {
+  for (size_t k = 0; k < ctx->group_size; ++k) {
     size_t idx = (k * 5) % esize;
 
-    fe_clone(endos[idx + 0].x, points[k].x); // (x, -y)
-    fe_modp_neg(endos[idx + 0].y, points[k].y);
+    fe_clone(ex[idx + 0], points.x[k]); // (x, -y)
+    fe_modp_neg(ey[idx + 0], points.y[k]);
 
-    fe_modp_mul(endos[idx + 1].x, points[k].x, B1); // (x * beta, y)
-    fe_clone(endos[idx + 1].y, points[k].y);
+    fe_modp_mul(ex[idx + 1], points.x[k], B1); // (x * beta, y)
+    fe_clone(ey[idx + 1], points.y[k]);
 
-    fe_clone(endos[idx + 2].x, endos[idx + 1].x); // (x * beta, -y)
-    fe_clone(endos[idx + 2].y, endos[idx + 0].y);
+    fe_clone(ex[idx + 2], ex[idx + 1]); // (x * beta, -y)
+    fe_clone(ey[idx + 2], ey[idx + 0]);
 
-    fe_modp_mul(endos[idx + 3].x, points[k].x, B2); // (x * beta^2, y)
-    fe_clone(endos[idx + 3].y, points[k].y);
+    fe_modp_mul(ex[idx + 3], points.x[k], B2); // (x * beta^2, y)
+    fe_clone(ey[idx + 3], points.y[k]);
 
-    fe_clone(endos[idx + 4].x, endos[idx + 3].x); // (x * beta^2, -y)
-    fe_clone(endos[idx + 4].y, endos[idx + 0].y);
+    fe_clone(ex[idx + 4], ex[idx + 3]); // (x * beta^2, -y)
+    fe_clone(ey[idx + 4], ey[idx + 0]);
 
-    bool is_full = (idx + 5) % esize == 0 || k == GROUP_INV_SIZE - 1;
+    bool is_full = (idx + 5) % esize == 0 || k == ctx->group_size - 1;
     if (!is_full) continue;
 
-    for (size_t i = 0; i < esize; i += HASH_BATCH_SIZE) {
-      if (ctx->check_addr33) addr33_batch(hs33, endos + i, HASH_BATCH_SIZE);
-      if (ctx->check_addr65) addr65_batch(hs65, endos + i, HASH_BATCH_SIZE);
-
-      for (size_t j = 0; j < HASH_BATCH_SIZE; j += 8) {
-        uint8_t mask33[8] = {1,1,1,1,1,1,1,1};
-        uint8_t mask65[8] = {1,1,1,1,1,1,1,1};
-        size_t remain = MIN(8ul, HASH_BATCH_SIZE - j);
-        if (ctx->blf.bits != NULL) {
-          if (ctx->check_addr33)
-            blf_has8(mask33, &ctx->blf, (const h160_t *)(hs33 + j));
-          if (ctx->check_addr65)
-            blf_has8(mask65, &ctx->blf, (const h160_t *)(hs65 + j));
-        }
-        for (size_t k = 0; k < remain; ++k) {
-          if (ctx->check_addr33 && (ctx->blf.bits == NULL || mask33[k]))
-            check_hash(ctx, true, hs33[j + k], start_pk, ci / 5, (ci % 5) + 1);
-          if (ctx->check_addr65 && (ctx->blf.bits == NULL || mask65[k]))
-            check_hash(ctx, false, hs65[j + k], start_pk, ci / 5, (ci % 5) + 1);
-          ci += 1;
-        }
-      }
+    // pipe keeps hashes, so the last batch can wait while endos are refilled
+    for (size_t i = 0; i < esize; i += HASH_BATCH_SIZE, ci += HASH_BATCH_SIZE) {
+      hb = hash_pipe_push(ctx, &pipe, pe_batch_at(endos, i), ci, HASH_BATCH_SIZE);
+      check_batch_add(ctx, start_pk, hb, true);
     }
   }
+  check_batch_add(ctx, start_pk, hash_pipe_flush(ctx, &pipe), true);
+
+  assert(ci == ctx->group_size * 5);
+}
+
+// per-worker buffers of batch_add (sized by group size, reused by every batch)
+typedef struct add_ws_t {
+  fe *bx;     // calculated ec points (x)
+  fe *by;     // calculated ec points (y)
+  fe *dx;     // delta x for group inversion
+  ec_ws_t ec; // group inversion scratch
+} add_ws_t;
+
+void add_ws_init(add_ws_t *ws, const size_t group_size) {
+  ws->bx = malloc(group_size * sizeof(fe));
+  ws->by = malloc(group_size * sizeof(fe));
+  ws->dx = malloc(group_size / 2 * sizeof(fe));
+  ws->ec = (ec_ws_t){0};
+  if (ws->bx == NULL || ws->by == NULL || ws->dx == NULL) {
+    fprintf(stderr, "failed to allocate group buffers\n");
+    exit(1);
+  }
+}
 
-  assert(ci == GROUP_INV_SIZE * 5);
+void add_ws_free(add_ws_t *ws) {
+  free(ws->bx);
+  free(ws->by);
+  free(ws->dx);
+  ec_ws_free(&ws->ec);
 }
 
-void batch_add(ctx_t *ctx, const fe pk, const size_t iterations) {
-  size_t hsize = GROUP_INV_SIZE / 2;
+void batch_add(ctx_t *ctx, const fe pk, const size_t iterations, add_ws_t *ws) {
+  size_t hsize = ctx->group_size / 2;
 
-  pe bp[GROUP_INV_SIZE]; // calculated ec points
-  fe dx[hsize];          // delta x for group inversion
-  pe GStart;             // iteration points
-  fe ck, rx, ry;         // current start point; tmp for x3, y3
-  fe ss, dd;             // temp variables
+  fe *bx = ws->bx; // calculated ec points (x)
+  fe *by = ws->by; // calculated ec points (y)
+  fe *dx = ws->dx; // delta x for group inversion
+  pe GStart;       // iteration points
+  fe ck;           // current start point
+  fe ss;           // temp variable
+  pe_batch_t bp = {.x = bx, .y = by};
 
   // set start point to center of the group
   fe_modn_add_stride(ss, pk, ctx->stride_k, hsize);
@@ -399,154 +619,251 @@ void batch_add(ctx_t *ctx, const fe pk, const size_t iterations) {
   size_t counter = 0;
   while (counter < iterations) {
     for (size_t i = 0; i < hsize; ++i) fe_modp_sub(dx[i], ctx->gpoints[i].x, GStart.x);
-    fe_modp_grpinv(dx, hsize);
+    fe_modp_grpinv(dx, hsize, &ws->ec);
 
-    pe_clone(&bp[hsize + 0], &GStart); // set K value
+    fe_clone(bx[hsize + 0], GStart.x); // set K value
+    fe_clone(by[hsize + 0], GStart.y);
 
     for (size_t D = 0; D < 2; ++D) {
       bool positive = D == 0;
       size_t g_idx = positive ? 0 : hsize; // plus points in first half, minus in second half
       size_t g_max = positive ? hsize - 1 : hsize; // skip K+N/2, since we don't need it
-      for (size_t i = 0; i < g_max; ++i) {
-        fe_modp_sub(ss, ctx->gpoints[g_idx + i].y, GStart.y); // y2 - y1
-        fe_modp_mul(ss, ss, dx[i]);                           // λ = (y2 - y1) / (x2 - x1)
-        fe_modp_sqr(rx, ss);                                  // λ²
-        fe_modp_sub(rx, rx, GStart.x);                        // λ² - x1
-        fe_modp_sub(rx, rx, ctx->gpoints[g_idx + i].x);       // rx = λ² - x1 - x2
-        fe_modp_sub(dd, GStart.x, rx);                        // x1 - rx
-        fe_modp_mul(dd, ss, dd);                              // λ * (x1 - rx)
-        fe_modp_sub(ry, dd, GStart.y);                        // ry = λ * (x1 - rx) - y1
+      size_t i = 0;
+      if (_ec_use_ifma) {
+        for (; i + 8 <= g_max; i += 8) {
+          size_t idx = positive ? hsize + i + 1 : hsize - 1 - i;
+          ec_affine_add_inv_x8(&bx[idx], &by[idx], positive ? 1 : -1, &GStart,
+                               &ctx->gpoints[g_idx + i], &dx[i]);
+        }
+      }
 
+      for (; i < g_max; ++i) {
         // ordered by pk:
         // [0]: K-N/2, [1]: K-N/2+1, .., [N/2-1]: K-1 // all minus points
         // [N/2]: K, [N/2+1]: K+1, .., [N-1]: K+N/2-1 // K, plus points without last element
         size_t idx = positive ? hsize + i + 1 : hsize - 1 - i;
-        fe_clone(bp[idx].x, rx);
-        fe_clone(bp[idx].y, ry);
-        fe_set64(bp[idx].z, 0x1);
+        pe *gp = &ctx->gpoints[g_idx + i];
+        ec_affine_add_inv(bx[idx], by[idx], GStart.x, GStart.y, gp->x, gp->y, dx[i]);
       }
     }
 
     check_found_add(ctx, ck, bp);
-    fe_modn_add_stride(ck, ck, ctx->stride_k, GROUP_INV_SIZE); // move pk to next group START
-    ec_jacobi_addrdc(&GStart, &GStart, &ctx->stride_p);        // move GStart to next group CENTER
-    counter += GROUP_INV_SIZE;
+    fe_modn_add_stride(ck, ck, ctx->stride_k, ctx->group_size); // move pk to next group START
+    ec_jacobi_addrdc(&GStart, &GStart, &ctx->stride_p);         // move GStart to next group CENTER
+    counter += ctx->group_size;
   }
 }
 
-void *cmd_add_worker(void *arg) {
-  add_job_t *job = (add_job_t *)arg;
-  ctx_t *ctx = job->ctx;
+// set job size for range of given size: ~8 jobs per thread for small ranges, so the
+// work balances between threads, and MAX_JOB_SIZE for large ones; multiple of group size
+void ctx_set_job_size(ctx_t *ctx, const fe range_size) {
+  size_t jobs = ctx->threads_count * 8;
+  size_t size = MAX_JOB_SIZE;
+  if (fe_cmp64(range_size, (u64)MAX_JOB_SIZE * jobs) < 0) size = range_size[0] / jobs;
 
-  fe current;
-  fe_clone(current, job->start);
-  fe end;
-  fe_clone(end, job->end);
-  fe initial_r;
-  fe_clone(initial_r, current);
+  size = (size + ctx->group_size - 1) / ctx->group_size * ctx->group_size;
+  ctx->job_size = MAX(size, ctx->group_size);
 
   // job_size multiply by 2^offset (iterate over desired digit order)
   // for example: 3013 3023 .. 30X3 .. 3093 3103 3113
-  fe inc = {0};
-  fe_set64(inc, ctx->job_size);
-  fe_modn_mul(inc, inc, ctx->stride_k);
+  fe_set64(ctx->job_inc, ctx->job_size);
+  fe_modn_mul(ctx->job_inc, ctx->job_inc, ctx->stride_k);
+}
+
+// run batch addition for one job and account it to the worker
+void worker_batch_add(worker_t *w, const fe pk, add_ws_t *ws) {
+  ctx_t *ctx = w->ctx;
+  size_t k_checked = ctx->use_endo ? ctx->job_size * 6 : ctx->job_size;
+
+  size_t ts = tsnow();
+  batch_add(ctx, pk, ctx->job_size, ws);
+  w->ts_busy += tsnow() - ts;
+  w->jobs += 1;
+
+  worker_update(w, k_checked);
+}
 
+void *cmd_add_worker(void *arg) {
+  worker_t *w = (worker_t *)arg;
+  ctx_t *ctx = w->ctx;
+
+  add_ws_t ws; // reused by every batch of this worker
+  add_ws_init(&ws, ctx->group_size);
+
+  // claim jobs from shared cursor, so fast threads take more of them; job_cur is set to
+  // cursor before claiming, so reporter never sees a claimed job as done (see frontier)
   fe pk;
   while (true) {
-    bool is_overflow = fe_cmp(current, initial_r) < 0;
-    if (fe_cmp(current, end) >= 0 || is_overflow) {
-      break;
-    }
+    atomic_store(&w->job_cur, atomic_load(&ctx->job_next));
+    size_t idx = atomic_fetch_add(&ctx->job_next, 1);
+    fe_modn_add_stride(pk, ctx->range_s, ctx->job_inc, idx);
 
-    fe_clone(pk, current);
-    fe_modn_add(current, current, inc);
+    bool is_overflow = fe_cmp(pk, ctx->range_s) < 0;
+    if (fe_cmp(pk, ctx->range_e) >= 0 || is_overflow) break;
 
-    batch_add(ctx, pk, ctx->job_size);
-    ctx_update(ctx, ctx->use_endo ? ctx->job_size * 6 : ctx->job_size);
+    worker_batch_add(w, pk, &ws);
   }
 
+  atomic_store(&w->job_cur, SIZE_MAX);
+  add_ws_free(&ws);
   return NULL;
 }
 
+// MARK: checkpoint
+
+// all jobs below returned index are completed: a worker stores a lower bound of its job in
+// job_cur before claiming it, and cursor is read first, so later claims are not below it
+size_t ctx_add_frontier(ctx_t *ctx) {
+  size_t frontier = atomic_load(&ctx->job_next);
+  for (size_t i = 0; i < ctx->threads_count; ++i) {
+    frontier = MIN(frontier, atomic_load(&ctx->workers[i].job_cur));
+  }
+  return frontier;
+}
+
+void ctx_checkpoint_save(ctx_t *ctx) {
+  if (ctx->ckpt_path == NULL || !ctx->ckpt_ready) return;
+  pthread_mutex_lock(&ctx->ckpt_lock); // final write on Ctrl-C waits for periodic one
+
+  fe next; // first key of not completed job
+  fe_modn_add_stride(next, ctx->range_s, ctx->job_inc, ctx_add_frontier(ctx));
+  bool is_overflow = fe_cmp(next, ctx->range_s) < 0;
+  if (fe_cmp(next, ctx->range_e) > 0 || is_overflow) fe_clone(next, ctx->range_e);
+
+  // written to temp file and renamed, so checkpoint is never left half-written
+  FILE *file = file_create(ctx->ckpt_path, "w");
+  if (file == NULL) {
+    fprintf(stderr, "failed to write checkpoint: %s\n", ctx->ckpt_path);
+    pthread_mutex_unlock(&ctx->ckpt_lock);
+    return;
+  }
+
+  const u64 *rs = ctx->ckpt_range_s, *re = ctx->range_e;
+  fprintf(file, "range: %016llx%016llx%016llx%016llx:%016llx%016llx%016llx%016llx\n", //
+          rs[3], rs[2], rs[1], rs[0], re[3], re[2], re[1], re[0]);
+  fprintf(file, "offset: %u\n", ctx->ord_offs);
+  fprintf(file, "next: %016llx%016llx%016llx%016llx\n", next[3], next[2], next[1], next[0]);
+
+  if (!file_replace(file, ctx->ckpt_path, true)) {
+    fprintf(stderr, "failed to write checkpoint: %s\n", ctx->ckpt_path);
+  }
+
+  pthread_mutex_unlock(&ctx->ckpt_lock);
+}
+
+// continue from checkpoint file if it exists; it must be made for same range and offset
+void ctx_checkpoint_load(ctx_t *ctx, const char *path) {
+  ctx->ckpt_path = strdup(path);
+  pthread_mutex_init(&ctx->ckpt_lock, NULL);
+  fe_clone(ctx->ckpt_range_s, ctx->range_s);
+
+  FILE *file = fopen(path, "r");
+  if (file == NULL) return; // first run, file is created by reporter
+
+  char hs[65], he[65], hn[65];
+  u32 offs = 0;
+  int rc = fscanf(file, "range: %64[0-9a-f]:%64[0-9a-f] offset: %u next: %64[0-9a-f]", //
+                  hs, he, &offs, hn);
+  fclose(file);
+
+  fe range_s, range_e, next;
+  if (rc == 4) fe_from_hex(range_s, hs), fe_from_hex(range_e, he), fe_from_hex(next, hn);
+  if (rc != 4 || fe_cmp(next, range_s) < 0 || fe_cmp(next, range_e) > 0) {
+    fprintf(stderr, "invalid checkpoint file: %s\n", path);
+    exit(1);
+  }
+
+  bool is_same = fe_cmp(range_s, ctx->range_s) == 0 && fe_cmp(range_e, ctx->range_e) == 0;
+  if (!is_same || offs != ctx->ord_offs) {
+    fprintf(stderr, "checkpoint %s is for other search range or offset (-r, -d)\n", path);
+    exit(1);
+  }
+
+  if (fe_cmp(next, range_e) >= 0) {
+    fprintf(stderr, "checkpoint %s: search range is already completed\n", path);
+    exit(0);
+  }
+
+  fe_clone(ctx->range_s, next);
+}
+
 void cmd_add(ctx_t *ctx) {
   ctx_precompute_gpoints(ctx);
 
   fe range_size;
   fe_modn_sub(range_size, ctx->range_e, ctx->range_s);
-  ctx->job_size = fe_cmp64(range_size, MAX_JOB_SIZE) < 0 ? range_size[0] : MAX_JOB_SIZE;
-  ctx->ts_started = tsnow(); // actual start time
+  ctx_set_job_size(ctx, range_size);
+  atomic_store(&ctx->job_next, 0);
 
-  fe chunk;
-  fe_div_u64(chunk, range_size, ctx->threads_count);
-
-  add_job_t *jobs = malloc(ctx->threads_count * sizeof(add_job_t));
+  ctx_start(ctx);
+  atomic_store(&ctx->ckpt_ready, true);
   for (size_t i = 0; i < ctx->threads_count; ++i) {
-    jobs[i].ctx = ctx;
-    fe_modn_add_stride(jobs[i].start, ctx->range_s, chunk, i);
-    if (i == ctx->threads_count - 1)
-      fe_clone(jobs[i].end, ctx->range_e);
-    else
-      fe_modn_add_stride(jobs[i].end, ctx->range_s, chunk, i + 1);
-    pthread_create(&ctx->threads[i], NULL, cmd_add_worker, &jobs[i]);
+    pthread_create(&ctx->threads[i], NULL, cmd_add_worker, &ctx->workers[i]);
   }
 
   for (size_t i = 0; i < ctx->threads_count; ++i) {
     pthread_join(ctx->threads[i], NULL);
   }
-  free(jobs);
 
   ctx_finish(ctx);
 }
 
 // MARK: CMD_MUL
 
-void check_found_mul(ctx_t *ctx, const fe *pk, const pe *cp, size_t cnt) {
-  h160_t hs33[HASH_BATCH_SIZE];
-  h160_t hs65[HASH_BATCH_SIZE];
+void check_batch_mul(ctx_t *ctx, const fe *pk, const hash_batch_t *hb) {
+  if (hb == NULL) return;
+
+  for (size_t k = 0; k < hb->count; ++k) {
+    if (hb->m33[k] && ctx_check_hash(ctx, hb->hs33[k]))
+      ctx_write_found(ctx, "addr33", hb->hs33[k], pk[hb->offs + k]);
+    if (hb->m65[k] && ctx_check_hash(ctx, hb->hs65[k]))
+      ctx_write_found(ctx, "addr65", hb->hs65[k], pk[hb->offs + k]);
+  }
+}
+
+void check_found_mul(ctx_t *ctx, const fe *pk, const pe_batch_t cp, size_t cnt) {
+  hash_pipe_t pipe = {0};
 
   for (size_t i = 0; i < cnt; i += HASH_BATCH_SIZE) {
     size_t batch_size = MIN(HASH_BATCH_SIZE, cnt - i);
-    if (ctx->check_addr33) addr33_batch(hs33, cp + i, batch_size);
-    if (ctx->check_addr65) addr65_batch(hs65, cp + i, batch_size);
-
-    for (size_t j = 0; j < HASH_BATCH_SIZE; j += 8) {
-      uint8_t mask33[8] = {1,1,1,1,1,1,1,1};
-      uint8_t mask65[8] = {1,1,1,1,1,1,1,1};
-      size_t remain = MIN(8ul, HASH_BATCH_SIZE - j);
-      if (ctx->blf.bits != NULL) {
-        if (ctx->check_addr33)
-          blf_has8(mask33, &ctx->blf, (const h160_t *)(hs33 + j));
-        if (ctx->check_addr65)
-          blf_has8(mask65, &ctx->blf, (const h160_t *)(hs65 + j));
-      }
-      for (size_t k = 0; k < remain; ++k) {
-        if (ctx->check_addr33 && (ctx->blf.bits == NULL || mask33[k])) {
-          if (ctx_check_hash(ctx, hs33[j + k]))
-            ctx_write_found(ctx, "addr33", hs33[j + k], pk[i + j + k]);
-        }
-        if (ctx->check_addr65 && (ctx->blf.bits == NULL || mask65[k])) {
-          if (ctx_check_hash(ctx, hs65[j + k]))
-            ctx_write_found(ctx, "addr65", hs65[j + k], pk[i + j + k]);
-        }
-      }
-    }
+    check_batch_mul(ctx, pk, hash_pipe_push(ctx, &pipe, pe_batch_at(cp, i), i, batch_size));
   }
+  check_batch_mul(ctx, pk, hash_pipe_flush(ctx, &pipe));
 }
 
 typedef struct cmd_mul_job_t {
   size_t count;
-  char lines[GROUP_INV_SIZE][MAX_LINE_SIZE];
+  char lines[][MAX_LINE_SIZE]; // group_size lines
 } cmd_mul_job_t;
 
+cmd_mul_job_t *cmd_mul_job_new(const ctx_t *ctx) {
+  cmd_mul_job_t *job = calloc(1, sizeof(cmd_mul_job_t) + ctx->group_size * MAX_LINE_SIZE);
+  if (job == NULL) {
+    fprintf(stderr, "failed to allocate job\n");
+    exit(1);
+  }
+  return job;
+}
+
 void *cmd_mul_worker(void *arg) {
-  ctx_t *ctx = (ctx_t *)arg;
+  worker_t *w = (worker_t *)arg;
+  ctx_t *ctx = w->ctx;
 
   // sha256 routine
   u8 msg[(MAX_LINE_SIZE + 63 + 9) / 64 * 64] = {0}; // 9 = 1 byte 0x80 + 8 byte bitlen
   u32 res[8] = {0};
 
-  fe pk[GROUP_INV_SIZE];
-  pe cp[GROUP_INV_SIZE];
+  fe *pk = malloc(ctx->group_size * sizeof(fe));
+  pe *cp = malloc(ctx->group_size * sizeof(pe));
+  fe *cx = malloc(ctx->group_size * sizeof(fe));
+  fe *cy = malloc(ctx->group_size * sizeof(fe));
+  if (pk == NULL || cp == NULL || cx == NULL || cy == NULL) {
+    fprintf(stderr, "failed to allocate group buffers\n");
+    exit(1);
+  }
+
+  pe_batch_t cb = {.x = cx, .y = cy};
+  ec_ws_t ws = {0}; // reused by every job of this worker
   cmd_mul_job_t *job = NULL;
 
   while (true) {
@@ -554,6 +871,8 @@ void *cmd_mul_worker(void *arg) {
     job = queue_get(&ctx->queue);
     if (job == NULL) break;
 
+    size_t ts = tsnow();
+
     // parse private keys from hex string
     if (!ctx->raw_text) {
       for (size_t i = 0; i < job->count; ++i) fe_modn_from_hex(pk[i], job->lines[i]);
@@ -584,24 +903,28 @@ void *cmd_mul_worker(void *arg) {
 
     // compute public keys in batch
     for (size_t i = 0; i < job->count; ++i) ec_gtable_mul(&cp[i], pk[i]);
-    ec_jacobi_grprdc(cp, job->count);
+    ec_jacobi_grprdc(cp, job->count, &ws);
+    for (size_t i = 0; i < job->count; ++i) fe_clone(cx[i], cp[i].x), fe_clone(cy[i], cp[i].y);
 
-    check_found_mul(ctx, pk, cp, job->count);
-    ctx_update(ctx, job->count);
+    check_found_mul(ctx, pk, cb, job->count);
+    w->ts_busy += tsnow() - ts;
+    w->jobs += 1;
+    worker_update(w, job->count);
   }
 
   if (job != NULL) free(job);
+  ec_ws_free(&ws);
+  free(pk), free(cp), free(cx), free(cy);
   return NULL;
 }
 
 void cmd_mul(ctx_t *ctx) {
-  ec_gtable_init();
-
+  ctx_start(ctx);
   for (size_t i = 0; i < ctx->threads_count; ++i) {
-    pthread_create(&ctx->threads[i], NULL, cmd_mul_worker, ctx);
+    pthread_create(&ctx->threads[i], NULL, cmd_mul_worker, &ctx->workers[i]);
   }
 
-  cmd_mul_job_t *job = calloc(1, sizeof(cmd_mul_job_t));
+  cmd_mul_job_t *job = cmd_mul_job_new(ctx);
   char line[MAX_LINE_SIZE];
 
   while (fgets(line, sizeof(line), stdin) != NULL) {
@@ -611,13 +934,13 @@ void cmd_mul(ctx_t *ctx) {
     if (len == 0) continue;
 
     strcpy(job->lines[job->count++], line);
-    if (job->count == GROUP_INV_SIZE) {
+    if (job->count == ctx->group_size) {
       queue_put(&ctx->queue, job);
-      job = calloc(1, sizeof(cmd_mul_job_t));
+      job = cmd_mul_job_new(ctx);
     }
   }
 
-  if (job->count > 0 && job->count != GROUP_INV_SIZE) {
+  if (job->count > 0 && job->count != ctx->group_size) {
     queue_put(&ctx->queue, job);
   }
 
@@ -671,6 +994,92 @@ void print_range_mask(fe range_s, u32 bits_size, u32 offset, bool use_color) {
   putchar('\n');
 }
 
+// random range in flight; sub-ranges of it are streamed to the workers through ctx->queue,
+// mask and summary of it are printed by reporter thread
+typedef struct rnd_range_t {
+  struct rnd_range_t *next;
+  fe range_s;               // range start (for print)
+  fe range_e;               // range end (for print)
+  atomic_bool claimed;      // true if any worker took a sub-range of it
+  atomic_bool started;      // true when k_found and ts_started are set
+  atomic_size_t refs;       // queued sub-ranges + producer reference
+  atomic_size_t k_checked;  // keys checked in this range
+  size_t k_found;           // ctx->k_found when range was started
+  size_t ts_started;        // timestamp when range was started
+  bool printed;             // true if mask of range was printed (reporter only)
+} rnd_range_t;
+
+typedef struct rnd_job_t {
+  rnd_range_t *range;
+  fe start; // first pk of the sub-range (job_size keys)
+} rnd_job_t;
+
+// mark range as started by the first worker taking a sub-range of it
+void rnd_range_start(ctx_t *ctx, rnd_range_t *range) {
+  if (atomic_exchange(&range->claimed, true)) return;
+  range->k_found = atomic_load(&ctx->k_found);
+  range->ts_started = tsnow();
+  atomic_store(&range->started, true);
+  pthread_cond_signal(&ctx->report_cond);
+}
+
+// drop one reference to the range, reporter prints its summary when it was the last one
+void rnd_range_release(ctx_t *ctx, rnd_range_t *range, size_t k_checked) {
+  atomic_fetch_add(&range->k_checked, k_checked);
+  if (atomic_fetch_sub(&range->refs, 1) == 1) pthread_cond_signal(&ctx->report_cond);
+}
+
+// note: called by reporter with ctx->lock held
+void rnd_ranges_report(ctx_t *ctx) {
+  rnd_range_t **link = &ctx->rnd_ranges;
+  while (*link != NULL) {
+    rnd_range_t *range = *link;
+    bool started = atomic_load(&range->started);
+
+    if (started && !range->printed && !ctx->quiet) {
+      term_clear_line();
+      print_range_mask(range->range_s, ctx->ord_size, ctx->ord_offs, ctx->use_color);
+      print_range_mask(range->range_e, ctx->ord_size, ctx->ord_offs, ctx->use_color);
+      range->printed = true;
+    }
+
+    if (atomic_load(&range->refs) != 0) {
+      link = &range->next;
+      continue;
+    }
+
+    if (started && !ctx->quiet) {
+      size_t df = atomic_load(&ctx->k_found) - range->k_found;
+      double dt = MAX((tsnow() - range->ts_started), 1ul) / 1000.0;
+      term_clear_line();
+      printf("%'zu / %'zu ~ %.1fs\n\n", df, (size_t)range->k_checked, dt);
+    }
+
+    *link = range->next;
+    free(range);
+  }
+}
+
+void *cmd_rnd_worker(void *arg) {
+  worker_t *w = (worker_t *)arg;
+  ctx_t *ctx = w->ctx;
+  size_t k_checked = ctx->use_endo ? ctx->job_size * 6 : ctx->job_size;
+
+  add_ws_t ws; // reused by every sub-range of this worker
+  add_ws_init(&ws, ctx->group_size);
+
+  rnd_job_t *job = NULL;
+  while ((job = queue_get(&ctx->queue)) != NULL) {
+    rnd_range_start(ctx, job->range);
+    worker_batch_add(w, job->start, &ws);
+    rnd_range_release(ctx, job->range, k_checked);
+    free(job);
+  }
+
+  add_ws_free(&ws);
+  return NULL;
+}
+
 void cmd_rnd(ctx_t *ctx) {
   ctx->ord_offs = MIN(ctx->ord_offs, 255 - ctx->ord_size);
   if (!ctx->quiet)
@@ -678,71 +1087,116 @@ void cmd_rnd(ctx_t *ctx) {
            ctx->ord_size);
 
   ctx_precompute_gpoints(ctx);
-  ctx->job_size = MAX_JOB_SIZE;
-  ctx->ts_started = tsnow(); // actual start time
 
   fe range_s, range_e;
   fe_clone(range_s, ctx->range_s);
   fe_clone(range_e, ctx->range_e);
 
-  size_t last_c = 0, last_f = 0, s_time = 0;
-  while (true) {
-    last_c = ctx->k_checked;
-    last_f = ctx->k_found;
-    s_time = tsnow();
+  fe range_size = {0}; // keys in each random range (2^ord_size)
+  fe_set64(range_size, 1);
+  fe_shiftl(range_size, ctx->ord_size);
+  ctx_set_job_size(ctx, range_size);
 
+  // workers live for the whole run and take sub-ranges from the queue, so the next
+  // random range is already in progress while the slowest chunk of the previous one ends
+  ctx_start(ctx);
+  for (size_t i = 0; i < ctx->threads_count; ++i) {
+    pthread_create(&ctx->threads[i], NULL, cmd_rnd_worker, &ctx->workers[i]);
+  }
+
+  while (true) {
     gen_random_range(ctx, range_s, range_e);
-    if (!ctx->quiet) {
-      print_range_mask(ctx->range_s, ctx->ord_size, ctx->ord_offs,
-                       ctx->use_color);
-      print_range_mask(ctx->range_e, ctx->ord_size, ctx->ord_offs,
-                       ctx->use_color);
-    }
-    ctx_print_status(ctx);
+
+    rnd_range_t *range = calloc(1, sizeof(rnd_range_t));
+    fe_clone(range->range_s, ctx->range_s);
+    fe_clone(range->range_e, ctx->range_e);
+    range->refs = 1; // released after all sub-ranges are queued
+
+    pthread_mutex_lock(&ctx->lock);
+    rnd_range_t **link = &ctx->rnd_ranges;
+    while (*link != NULL) link = &(*link)->next;
+    *link = range;
+    pthread_mutex_unlock(&ctx->lock);
 
     // if full range is used, skip break after first iteration
     bool is_full = fe_cmp(ctx->range_s, range_s) == 0 && fe_cmp(ctx->range_e, range_e) == 0;
 
-    fe range_size;
-    fe_modn_sub(range_size, ctx->range_e, ctx->range_s);
-    fe chunk;
-    fe_div_u64(chunk, range_size, ctx->threads_count);
-
-    add_job_t *jobs = malloc(ctx->threads_count * sizeof(add_job_t));
-    for (size_t i = 0; i < ctx->threads_count; ++i) {
-      jobs[i].ctx = ctx;
-      fe_modn_add_stride(jobs[i].start, ctx->range_s, chunk, i);
-      if (i == ctx->threads_count - 1)
-        fe_clone(jobs[i].end, ctx->range_e);
-      else
-        fe_modn_add_stride(jobs[i].end, ctx->range_s, chunk, i + 1);
-      pthread_create(&ctx->threads[i], NULL, cmd_add_worker, &jobs[i]);
-    }
+    fe current;
+    fe_clone(current, ctx->range_s);
+    while (fe_cmp(current, ctx->range_e) < 0) {
+      rnd_job_t *job = malloc(sizeof(rnd_job_t));
+      job->range = range;
+      fe_clone(job->start, current);
 
-    for (size_t i = 0; i < ctx->threads_count; ++i) {
-      pthread_join(ctx->threads[i], NULL);
-    }
-    free(jobs);
+      atomic_fetch_add(&range->refs, 1);
+      queue_put(&ctx->queue, job);
 
-    size_t dc = ctx->k_checked - last_c, df = ctx->k_found - last_f;
-    double dt = MAX((tsnow() - s_time), 1ul) / 1000.0;
-    if (!ctx->quiet) {
-      term_clear_line();
-      printf("%'zu / %'zu ~ %.1fs\n\n", df, dc, dt);
+      fe_modn_add(current, current, ctx->job_inc);
+      if (fe_cmp(current, ctx->range_s) < 0) break; // overflow
     }
 
+    rnd_range_release(ctx, range, 0); // producer reference
     if (is_full) break;
   }
 
+  queue_done(&ctx->queue);
+  for (size_t i = 0; i < ctx->threads_count; ++i) {
+    pthread_join(ctx->threads[i], NULL);
+  }
+
   ctx_finish(ctx);
 }
 
+// MARK: bench-group
+
+void run_bench_group(args_t *args) {
+  ctx_t ctx = {0};
+  pthread_mutex_init(&ctx.lock, NULL);
+  pthread_cond_init(&ctx.report_cond, NULL);
+  ctx.quiet = true;
+  ctx.check_addr33 = true;
+  ctx.threads_count = MIN(MAX(args_uint(args, "-t", 1), 1ul), 320ul);
+  ctx.threads = malloc(ctx.threads_count * sizeof(pthread_t));
+
+  char *path = arg_str(args, "-f");
+  if (path != NULL) {
+    load_filter(&ctx, path);
+  } else {
+    // single-entry filter, so all keys are hashed and probed as in real search
+    h160_t h = {0};
+    blf_alloc(&ctx.blf, 1024, BLF_VERSION);
+    blf_add(&ctx.blf, h);
+  }
+
+  size_t keys = (1 << 22) * ctx.threads_count;
+  size_t best_size = 0;
+  double best_rate = 0;
+
+  printf("threads: %zu ~ keys per size: %'zu\n", ctx.threads_count, keys);
+  for (size_t g = 256; g <= 16384; g *= 2) {
+    ctx.group_size = g;
+    ctx.k_checked = 0;
+    fe_set64(ctx.range_s, MAX_GROUP_SIZE + 1);
+    fe_set64(ctx.range_e, MAX_GROUP_SIZE + 1 + keys);
+
+    size_t stime = tsnow();
+    cmd_add(&ctx);
+    double dt = MAX(tsnow() - stime, 1ul) / 1000.0;
+
+    double rate = ctx.k_checked / dt / 1000000;
+    if (rate > best_rate) best_rate = rate, best_size = g;
+    printf("g=%05zu: %6.2fM keys/s | %5.2fs\n", g, rate, dt);
+  }
+
+  printf("best: -g %zu (%.2fM keys/s)\n", best_size, best_rate);
+}
+
 // MARK: args helpers
 
-void arg_search_range(args_t *args, fe range_s, fe range_e) {
+void arg_search_range(args_t *args, fe range_s, fe range_e, const size_t min_start) {
   char *raw = arg_str(args, "-r");
   if (!raw) {
-    fe_set64(range_s, GROUP_INV_SIZE);
+    fe_set64(range_s, min_start);
     fe_clone(range_e, FE_P);
     return;
   }
@@ -757,11 +1211,11 @@ void arg_search_range(args_t *args, fe range_s, fe range_e) {
   fe_modn_from_hex(range_s, raw);
   fe_modn_from_hex(range_e, sep + 1);
 
-  // if (fe_cmp64(range_s, GROUP_INV_SIZE) <= 0) fe_set64(range_s, GROUP_INV_SIZE + 1);
+  // if (fe_cmp64(range_s, min_start) <= 0) fe_set64(range_s, min_start + 1);
   // if (fe_cmp(range_e, FE_P) > 0) fe_clone(range_e, FE_P);
 
-  if (fe_cmp64(range_s, GROUP_INV_SIZE) <= 0) {
-    fprintf(stderr, "invalid search range, start <= %#lx\n", GROUP_INV_SIZE);
+  if (fe_cmp64(range_s, min_start) <= 0) {
+    fprintf(stderr, "invalid search range, start <= %#lx\n", min_start);
     exit(1);
   }
 
@@ -776,6 +1230,16 @@ void arg_search_range(args_t *args, fe range_s, fe range_e) {
   }
 }
 
+size_t arg_group_size(args_t *args) {
+  size_t size = args_uint(args, "-g", GROUP_INV_SIZE);
+  if (size < MIN_GROUP_SIZE || size > MAX_GROUP_SIZE || size % HASH_BATCH_SIZE != 0) {
+    fprintf(stderr, "invalid group size, must be multiple of %lu in range %lu..%lu\n",
+            HASH_BATCH_SIZE, MIN_GROUP_SIZE, MAX_GROUP_SIZE);
+    exit(1);
+  }
+  return size;
+}
+
 void load_offs_size(ctx_t *ctx, args_t *args) {
   const u32 MIN_SIZE = 20;
   const u32 MAX_SIZE = 64;
@@ -831,7 +1295,7 @@ void usage(const char *name) {
   printf("  mul             - search hex encoded private keys (from stdin)\n");
   printf("  rnd             - search random range of bits in given range\n");
   printf("\nCompute options:\n");
-  printf("  -f <file>       - filter file to search (list of hashes or bloom fitler)\n");
+  printf("  -f <file>       - filter file to search (hashes list, .h160, .blf or .bff filter)\n");
   printf("  -o <file>       - output file to write found keys (default: stdout)\n");
   printf("  -t <threads>    - number of threads to run (default: 1)\n");
   printf("  -a <addr_type>  - address type to search: c - addr33, u - addr65 (default: c)\n");
@@ -840,21 +1304,34 @@ void usage(const char *name) {
   printf("  -q              - quiet mode (no output to stdout; -o required)\n");
   printf("  -s <sec>        - seconds between status prints (default: 1)\n");
   printf("  -endo           - use endomorphism (default: false)\n");
+  printf("  -g <size>       - points per group inversion (default: %lu, see bench-group)\n",
+         GROUP_INV_SIZE);
+  printf("  -populate       - load whole .blf / .h160 file at start (default: on demand)\n");
+  printf("  -hugepages      - use 2M / 1G pages for filter and gtable when available\n");
+  printf("  -resume <file>  - save add progress to file and continue from it on restart\n");
   printf("\nOther commands:\n");
   printf("  blf-gen         - create bloom filter from list of hex-encoded hash160\n");
   printf("  blf-check       - check bloom filter for given hex-encoded hash160\n");
+  printf("  bff-gen         - create binary fuse filter from list of hex-encoded hash160\n");
+  printf("  h160-gen        - convert list of hex-encoded hash160 to .h160 file\n");
   printf("  bench           - run benchmark of internal functions\n");
   printf("  bench-gtable    - run benchmark of ecc multiplication (with different table size)\n");
+  printf("  bench-group     - run benchmark of batch addition (with different group size)\n");
   printf("\n");
 }
 
 void init(ctx_t *ctx, args_t *args) {
+  _HUGE_PAGES = args_bool(args, "-hugepages");
+
   // check other commands first
   if (args->argc > 1) {
     if (strcmp(args->argv[1], "blf-gen") == 0) return blf_gen(args);
     if (strcmp(args->argv[1], "blf-check") == 0) return blf_check(args);
+    if (strcmp(args->argv[1], "bff-gen") == 0) return bff_gen(args);
+    if (strcmp(args->argv[1], "h160-gen") == 0) return h160_gen(args);
     if (strcmp(args->argv[1], "bench") == 0) return run_bench();
     if (strcmp(args->argv[1], "bench-gtable") == 0) return run_bench_gtable();
+    if (strcmp(args->argv[1], "bench-group") == 0) return run_bench_group(args);
     if (strcmp(args->argv[1], "mult-verify") == 0) return mult_verify();
   }
 
@@ -884,6 +1361,7 @@ void init(ctx_t *ctx, args_t *args) {
   prng_seed(seed_val);
 
   char *path = arg_str(args, "-f");
+  ctx->populate = args_bool(args, "-populate");
   load_filter(ctx, path);
 
   ctx->quiet = args_bool(args, "-q");
@@ -910,6 +1388,7 @@ void init(ctx_t *ctx, args_t *args) {
   if (ctx->cmd == CMD_MUL) ctx->use_endo = false; // no endo for mul command
 
   pthread_mutex_init(&ctx->lock, NULL);
+  pthread_cond_init(&ctx->report_cond, NULL);
   int cpus = get_cpu_count();
   ctx->threads_count = MIN(MAX(args_uint(args, "-t", cpus), 1ul), 320ul);
   ctx->threads = malloc(ctx->threads_count * sizeof(pthread_t));
@@ -922,23 +1401,50 @@ void init(ctx_t *ctx, args_t *args) {
   ctx->paused_time = 0;
   ctx->paused = false;
 
-  arg_search_range(args, ctx->range_s, ctx->range_e);
+  ctx->group_size = arg_group_size(args);
+  arg_search_range(args, ctx->range_s, ctx->range_e, ctx->group_size);
   load_offs_size(ctx, args);
+
+  char *resume = arg_str(args, "-resume");
+  if (resume != NULL && ctx->cmd != CMD_ADD) {
+    fprintf(stderr, "-resume is supported only by add command\n");
+    exit(1);
+  }
+  if (resume != NULL) ctx_checkpoint_load(ctx, resume);
+
   queue_init(&ctx->queue, ctx->threads_count * 3);
+  if (ctx->cmd == CMD_MUL) ec_gtable_init();
 
   if (!ctx->quiet) {
-    printf("threads: %zu ~ addr33: %d ~ addr65: %d ~ endo: %d | filter: ", //
-           ctx->threads_count, ctx->check_addr33, ctx->check_addr65,
-           ctx->use_endo);
-
-    if (ctx->to_find_hashes != NULL)
-      printf("list (%'zu)\n", ctx->to_find_count);
+    printf("threads: %zu ~ addr33: %d ~ addr65: %d ~ endo: %d ~ group: %zu | filter: ", //
+           ctx->threads_count, ctx->check_addr33, ctx->check_addr65, ctx->use_endo,
+           ctx->group_size);
+
+    if (ctx->hset.buckets != NULL)
+      printf("list (%'zu%s%s)\n", ctx->hset.count, ctx->hset.map != NULL ? ", mmap" : "",
+             ctx->hset.bitmap != NULL ? ", bitmap" : "");
+    else if (ctx->bff.fp != NULL)
+      printf("fuse\n");
     else
-      printf("bloom\n");
+      printf("bloom v%u%s\n", ctx->blf.version, ctx->blf.map != NULL ? " (mmap)" : "");
+
+    if (_HUGE_PAGES) {
+      bool has_mem = ctx->hset.buckets != NULL || ctx->blf.bits != NULL;
+      printf("huge pages:");
+      if (ctx->hset.buckets != NULL) printf(" filter %s", hp_kind_str(ctx->hset.mem));
+      if (ctx->blf.bits != NULL) printf(" filter %s", hp_kind_str(ctx->blf.mem));
+      if (has_mem && _gtable != NULL) printf(" ~");
+      if (_gtable != NULL) printf(" gtable %s", hp_kind_str(_gtable_mem));
+      printf("\n");
+    }
 
     if (ctx->cmd == CMD_ADD) {
       fe_print("range_s", ctx->range_s);
       fe_print("range_e", ctx->range_e);
+      if (ctx->ckpt_path != NULL) {
+        bool is_resumed = fe_cmp(ctx->ckpt_range_s, ctx->range_s) != 0;
+        printf("checkpoint: %s%s\n", ctx->ckpt_path, is_resumed ? " (resumed)" : "");
+      }
     }
 
     if (ctx->cmd == CMD_MUL) {
@@ -951,13 +1457,47 @@ void init(ctx_t *ctx, args_t *args) {
   }
 }
 
+_Atomic(ctx_t *) _sig_ctx = NULL; // for SIGINT listener
+
 void handle_sigint(int sig) {
+  ctx_t *ctx = atomic_load(&_sig_ctx);
+  if (ctx != NULL) ctx_checkpoint_save(ctx); // keep progress of running jobs
   fflush(stderr);
   fflush(stdout);
   printf("\n");
   exit(sig);
 }
 
+#ifndef _WIN32
+// SIGINT is blocked in all threads and taken here with sigwait, so Ctrl-C is handled in
+// normal context: checkpoint write uses stdio and locks, which signal handlers can't use
+void *sigint_listener(void *arg) {
+  sigset_t *set = (sigset_t *)arg;
+  int sig = SIGINT;
+  while (sigwait(set, &sig) != 0) {
+  }
+
+  handle_sigint(sig);
+  return NULL;
+}
+#endif
+
+// note: call before starting other threads, they inherit blocked SIGINT
+void sigint_init() {
+#ifdef _WIN32
+  signal(SIGINT, handle_sigint); // console handler already runs in its own thread
+#else
+  static sigset_t set;
+  sigemptyset(&set);
+  sigaddset(&set, SIGINT);
+  pthread_sigmask(SIG_BLOCK, &set, NULL);
+
+  pthread_t listener;
+  pthread_create(&listener, NULL, sigint_listener, &set);
+  pthread_detach(listener);
+#endif
+}
+
 void tty_cb(void *ctx_raw, const char ch) {
   ctx_t *ctx = (ctx_t *)ctx_raw;
 
@@ -982,8 +1522,9 @@ int main(int argc, const char **argv) {
   ctx_t ctx = {0};
   init(&ctx, &args);
 
-  signal(SIGINT, handle_sigint); // Keep last progress line on Ctrl-C
-  tty_init(tty_cb, &ctx);        // override tty to handle pause/resume
+  atomic_store(&_sig_ctx, &ctx);
+  sigint_init();          // keep last progress line and checkpoint on Ctrl-C
+  tty_init(tty_cb, &ctx); // override tty to handle pause/resume
 
   if (ctx.cmd == CMD_ADD) cmd_add(&ctx);
   if (ctx.cmd == CMD_MUL) cmd_mul(&ctx);